@@ -1,3 +1,4 @@
 #include "Config.h"
 Config driverConfig = {};
-std::mutex driverConfigLock;
\ No newline at end of file
+std::mutex driverConfigLock;
+std::atomic<uint64_t> driverConfigGeneration = 1;
\ No newline at end of file
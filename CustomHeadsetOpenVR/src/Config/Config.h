@@ -2,6 +2,10 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <map>
+#include <atomic>
+#include <cstdint>
+#include "../Driver/MemoryAccounting.h"
 
 
 class Config{
@@ -18,18 +22,69 @@ public:
 		double blackLevel = 0;
 		// distortion profile to use
 		std::string distortionProfile = "MeganeX8K Default";
+		// resolution mode of the panels, 7104x3840 or 5328x2880
+		// the window, viewports, render target and distortion are derived from it
+		// changing this requires restarting SteamVR
+		std::string panelMode = "7104x3840";
 	};
 	// config for the MeganeX superlight 8K
 	MeganeX8KConfig meganeX8K;
 	
+	// settings that replace the MeganeX8K settings while a specific application is the scene application
+	class AppOverrideConfig{
+	public:
+		// distortion profile to use, empty to not override
+		// these profiles are built ahead of time so switching applications does not wait for a build
+		std::string distortionProfile = "";
+		// scale of the recommended render target in each dimension, 0 to not override
+		double renderTargetScale = 0;
+		// minimum black levels from 0 to 1, negative to not override
+		double blackLevel = -1;
+	};
+	// overrides by lower case executable name of the application, such as "dcs.exe"
+	std::map<std::string, AppOverrideConfig> appOverrides;
+	
+	class AdaptiveRenderTargetConfig{
+	public:
+		// adjust the recommended render target size to the gpu time of the scene application
+		bool enable = false;
+		// limits of the adaptive scale, this is multiplied with the renderTargetScale of the app override
+		double minScale = 0.7;
+		double maxScale = 1.2;
+		// fraction of the frame time the application should use on the gpu
+		double targetLoad = 0.8;
+		// how far the load has to be from targetLoad before the size is changed
+		double hysteresis = 0.1;
+		// read frame timings from this file instead of the compositor, for testing, see FrameTimingSource.h for the format
+		std::string timingFile = "";
+	};
+	// render target size recommendation driven by frame timings
+	AdaptiveRenderTargetConfig adaptiveRenderTarget;
+	
 	// reload the config every time a file is changed in the distortions directory
 	// this is for manual json editing, utilities should touch the main settings file when done modifying distortions instead
 	bool watchDistortionProfiles = false;
 	
-	// if the config has been changes and should be reloaded
-	// this will be set the false at the end of RunFrame
-	bool hasBeenUpdated = true;
+	// receive distortion profiles pushed by calibration tools through shared memory
+	// a pushed profile is used until the config is changed, see DistortionMailbox.h for the layout
+	bool enableDistortionMailbox = false;
+	
+	// number of background worker threads used for building distortion profiles, parsing files and other work off the main loop
+	// changing this requires restarting SteamVR
+	int workerThreads = 2;
+	// core indices that background workers should not run on, such as the cores the compositor uses
+	// changing this requires restarting SteamVR
+	std::vector<int> workerAvoidCores = {};
+	
+	// keep the most recent driver events in FlightRecorder.bin in the config folder so they survive a crash
+	// changing this requires restarting SteamVR
+	bool enableFlightRecorder = true;
 	
+	// write a trace of the driver startup timeline to StartupTrace.json in the config folder
+	bool writeStartupTrace = false;
+	
+	// memory held by this copy of the config, not a setting
+	TrackedMemory trackedMemory{MemorySubsystemConfig, sizeof(Config)};
 };
 
 // config for a single custom distortion profile
@@ -41,18 +96,28 @@ public:
 	std::string description = "";
 	// last time it was modified, used for reloading if changed
 	double modifiedTime = 0;
-	// type of distortion, None or RadialBezier
+	// type of distortion, None, RadialBezier or the name of a distortion plugin
 	std::string type = "None";
+	// the whole profile json, given to distortion plugins
+	std::string data = "";
+	// path of the file named by "blob" in the profile, given to distortion plugins, empty if there is none
+	std::string blobPath = "";
 	// main distortion
 	std::vector<double> distortions = {};
 	// additional distortion to apply to the red channel
 	std::vector<double> distortionsRed = {};
 	// additional distortion to apply to the blue channel
 	std::vector<double> distortionsBlue = {};
+	// memory held by this copy of the profile, set when it is parsed
+	TrackedMemory trackedMemory{MemorySubsystemConfig, sizeof(DistortionProfileConfig)};
 };
 
 // global config object
 extern Config driverConfig;
 
 // lock for the config to prevent updates while reading
-extern std::mutex driverConfigLock;
\ No newline at end of file
+extern std::mutex driverConfigLock;
+
+// incremented each time driverConfig is replaced, starts at 1 so the first config counts as an update
+// frame hooks keep the last generation they applied so a deferred hook still sees an update exactly once
+extern std::atomic<uint64_t> driverConfigGeneration;
\ No newline at end of file
@@ -2,8 +2,12 @@
 #include <thread>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <cctype>
 #include "nlohmann/json.hpp"
 #include "../Driver/DriverLog.h"
+#include "../Driver/WorkerPool.h"
+#include "../Driver/FlightRecorder.h"
 #include "Windows.h"
 
 
@@ -51,22 +55,93 @@ void ConfigLoader::ParseConfig(){
 			if(meganeX8KData["distortionProfile"].is_string()){
 				newConfig.meganeX8K.distortionProfile = meganeX8KData["distortionProfile"].get<std::string>();
 			}
+			if(meganeX8KData["panelMode"].is_string()){
+				newConfig.meganeX8K.panelMode = meganeX8KData["panelMode"].get<std::string>();
+			}
+		}
+		if(data["appOverrides"].is_object()){
+			for(auto& appOverrideEntry : data["appOverrides"].items()){
+				json& appOverrideData = appOverrideEntry.value();
+				if(!appOverrideData.is_object()){
+					continue;
+				}
+				Config::AppOverrideConfig appOverride;
+				if(appOverrideData["distortionProfile"].is_string()){
+					appOverride.distortionProfile = appOverrideData["distortionProfile"].get<std::string>();
+				}
+				if(appOverrideData["renderTargetScale"].is_number()){
+					appOverride.renderTargetScale = appOverrideData["renderTargetScale"].get<double>();
+				}
+				if(appOverrideData["blackLevel"].is_number()){
+					appOverride.blackLevel = appOverrideData["blackLevel"].get<double>();
+				}
+				std::string executable = appOverrideEntry.key();
+				std::transform(executable.begin(), executable.end(), executable.begin(), [](unsigned char c){ return (char)std::tolower(c); });
+				newConfig.appOverrides[executable] = appOverride;
+			}
+		}
+		if(data["adaptiveRenderTarget"].is_object()){
+			json adaptiveRenderTargetData = data["adaptiveRenderTarget"];
+			if(adaptiveRenderTargetData["enable"].is_boolean()){
+				newConfig.adaptiveRenderTarget.enable = adaptiveRenderTargetData["enable"].get<bool>();
+			}
+			if(adaptiveRenderTargetData["minScale"].is_number()){
+				newConfig.adaptiveRenderTarget.minScale = adaptiveRenderTargetData["minScale"].get<double>();
+			}
+			if(adaptiveRenderTargetData["maxScale"].is_number()){
+				newConfig.adaptiveRenderTarget.maxScale = adaptiveRenderTargetData["maxScale"].get<double>();
+			}
+			if(adaptiveRenderTargetData["targetLoad"].is_number()){
+				newConfig.adaptiveRenderTarget.targetLoad = adaptiveRenderTargetData["targetLoad"].get<double>();
+			}
+			if(adaptiveRenderTargetData["hysteresis"].is_number()){
+				newConfig.adaptiveRenderTarget.hysteresis = adaptiveRenderTargetData["hysteresis"].get<double>();
+			}
+			if(adaptiveRenderTargetData["timingFile"].is_string()){
+				newConfig.adaptiveRenderTarget.timingFile = adaptiveRenderTargetData["timingFile"].get<std::string>();
+			}
+		}
+		if(data["enableFlightRecorder"].is_boolean()){
+			newConfig.enableFlightRecorder = data["enableFlightRecorder"].get<bool>();
 		}
 		if(data["watchDistortionProfiles"].is_boolean()){
 			newConfig.watchDistortionProfiles = data["watchDistortionProfiles"].get<bool>();
 		}
+		if(data["enableDistortionMailbox"].is_boolean()){
+			newConfig.enableDistortionMailbox = data["enableDistortionMailbox"].get<bool>();
+		}
+		if(data["writeStartupTrace"].is_boolean()){
+			newConfig.writeStartupTrace = data["writeStartupTrace"].get<bool>();
+		}
+		if(data["workerThreads"].is_number()){
+			newConfig.workerThreads = data["workerThreads"].get<int>();
+		}
+		if(data["workerAvoidCores"].is_array()){
+			newConfig.workerAvoidCores = data["workerAvoidCores"].get<std::vector<int>>();
+		}
+		size_t appOverridesBytes = 0;
+		for(auto& appOverride : newConfig.appOverrides){
+			appOverridesBytes += memoryTreeNodeOverhead + sizeof(appOverride) + appOverride.first.capacity() + appOverride.second.distortionProfile.capacity();
+		}
+		newConfig.trackedMemory.Resize(sizeof(Config) + appOverridesBytes + newConfig.workerAvoidCores.capacity() * sizeof(int));
 		// write to global config
 		driverConfigLock.lock();
 		driverConfig = newConfig;
+		driverConfigGeneration++;
 		driverConfigLock.unlock();
+		driverFlightRecorder.Record(FlightRecorderConfigReload, configPath.c_str(), 1);
 	}catch(const std::exception& e){
 		DriverLog("Failed to parse config file: %s", e.what());
+		driverFlightRecorder.Record(FlightRecorderConfigReload, configPath.c_str(), 0);
 		return;
 	}
 }
 
 DistortionProfileConfig ConfigLoader::ParseDistortionConfig(std::string name){
-	std::string profilePath = GetConfigFolder() + "Distortion/" + name + ".json";
+	return ParseDistortionConfigFile(GetConfigFolder() + "Distortion/" + name + ".json", name);
+}
+
+DistortionProfileConfig ConfigLoader::ParseDistortionConfigFile(std::string profilePath, std::string name){
 	std::ifstream configFile(profilePath);
 	if(!configFile.is_open()){
 		DriverLog("Distortion profile not found at %s", profilePath.c_str());
@@ -94,6 +169,13 @@ DistortionProfileConfig ConfigLoader::ParseDistortionConfig(std::string name){
 		if(data["distortionsBlue"].is_array()){
 			profile.distortionsBlue = data["distortionsBlue"].get<std::vector<double>>();
 		}
+		if(data["blob"].is_string()){
+			// relative to the folder of the profile
+			profile.blobPath = (std::filesystem::path(profilePath).parent_path() / data["blob"].get<std::string>()).string();
+		}
+		profile.data = data.dump();
+		profile.trackedMemory.Resize(sizeof(DistortionProfileConfig) + profile.name.capacity() + profile.description.capacity() + profile.type.capacity() + profile.data.capacity() + profile.blobPath.capacity()
+			+ (profile.distortions.capacity() + profile.distortionsRed.capacity() + profile.distortionsBlue.capacity()) * sizeof(double));
 		return profile;
 	}catch(const std::exception& e){
 		DriverLog("Failed to parse distortion profile: %s", e.what());
@@ -101,62 +183,76 @@ DistortionProfileConfig ConfigLoader::ParseDistortionConfig(std::string name){
 	}
 }
 
-void ConfigLoader::WatcherThread(){
-	// watch for changes in the config file directory
-	std::string configPath = GetConfigFolder();
-	HANDLE hDir = CreateFileA(configPath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+void ConfigLoader::WatchDirectory(const std::string& path, std::function<void(const std::wstring&)> onChange){
+	HANDLE hDir = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
 	if(hDir == INVALID_HANDLE_VALUE){
-		DriverLog("Failed to open config directory for watching: %d", GetLastError());
+		DriverLog("Failed to open %s for watching: %d", path.c_str(), GetLastError());
 		return;
 	}
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	// ReadDirectoryChangesW needs a DWORD aligned buffer
+	DWORD buffer[256];
 	while(started){
-		DWORD bytesReturned;
-		char buffer[1024];
-		FILE_NOTIFY_INFORMATION* pNotify;
-		BOOL success = ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, &bytesReturned, NULL, NULL);
-		if(!success){
+		ResetEvent(overlapped.hEvent);
+		if(!ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, NULL, &overlapped, NULL)){
 			DriverLog("Failed to read directory changes: %d", GetLastError());
 			break;
 		}
-		pNotify = (FILE_NOTIFY_INFORMATION*)buffer;
-		do{
-			std::wstring fileName(pNotify->FileName, pNotify->FileNameLength / sizeof(wchar_t));
-			if(fileName == L"settings.json" && (pNotify->Action == FILE_ACTION_MODIFIED || pNotify->Action == FILE_ACTION_ADDED || pNotify->Action == FILE_ACTION_RENAMED_NEW_NAME)){
-				DriverLog("Config file changed, reloading...");
-				ParseConfig();
+		// wait for a change or for Stop, whichever comes first
+		HANDLE events[2] = {overlapped.hEvent, stopEvent};
+		DWORD bytesReturned = 0;
+		if(WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0){
+			// the read has to finish before the buffer goes out of scope
+			CancelIoEx(hDir, &overlapped);
+			GetOverlappedResult(hDir, &overlapped, &bytesReturned, TRUE);
+			break;
+		}
+		if(!GetOverlappedResult(hDir, &overlapped, &bytesReturned, FALSE)){
+			DriverLog("Failed to read directory changes: %d", GetLastError());
+			break;
+		}
+		// no bytes means there were too many changes for the buffer, report them as one unnamed change
+		if(bytesReturned == 0){
+			onChange(L"");
+		}else{
+			FILE_NOTIFY_INFORMATION* pNotify = (FILE_NOTIFY_INFORMATION*)buffer;
+			while(true){
+				if(pNotify->Action == FILE_ACTION_MODIFIED || pNotify->Action == FILE_ACTION_ADDED || pNotify->Action == FILE_ACTION_RENAMED_NEW_NAME){
+					onChange(std::wstring(pNotify->FileName, pNotify->FileNameLength / sizeof(wchar_t)));
+				}
+				if(pNotify->NextEntryOffset == 0){
+					break;
+				}
+				pNotify = (FILE_NOTIFY_INFORMATION*)((char*)pNotify + pNotify->NextEntryOffset);
 			}
-			pNotify = (FILE_NOTIFY_INFORMATION*)((char*)pNotify + pNotify->NextEntryOffset);
-		}while(pNotify->NextEntryOffset != 0);
-		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		}
+		// let editors finish writing before looking again, Stop ends the wait early
+		if(WaitForSingleObject(stopEvent, 200) == WAIT_OBJECT_0){
+			break;
+		}
 	}
+	CloseHandle(overlapped.hEvent);
+	CloseHandle(hDir);
+}
+
+void ConfigLoader::WatcherThread(){
+	// watch for changes in the config file directory
+	WatchDirectory(GetConfigFolder(), [this](const std::wstring& fileName){
+		if(fileName == L"settings.json" || fileName.empty()){
+			DriverLog("Config file changed, reloading...");
+			ReloadConfig();
+		}
+	});
 }
 
 void ConfigLoader::WatcherThreadDistortions(){
-	std::string configPath = GetConfigFolder() + "Distortion/";
-	HANDLE hDir = CreateFileA(configPath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-	if(hDir == INVALID_HANDLE_VALUE){
-		DriverLog("Failed to open distortion directory for watching: %d", GetLastError());
-		return;
-	}
-	while(started){
-		DWORD bytesReturned;
-		char buffer[1024];
-		FILE_NOTIFY_INFORMATION* pNotify;
-		BOOL success = ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, &bytesReturned, NULL, NULL);
-		if(!success){
-			DriverLog("Failed to read directory changes: %d", GetLastError());
-			break;
+	WatchDirectory(GetConfigFolder() + "Distortion/", [this](const std::wstring& fileName){
+		if(fileName.find(L".json") != std::wstring::npos || fileName.empty()){
+			DriverLog("Distortion profile changed, reloading...");
+			ReloadConfig();
 		}
-		pNotify = (FILE_NOTIFY_INFORMATION*)buffer;
-		do{
-			std::wstring fileName(pNotify->FileName, pNotify->FileNameLength / sizeof(wchar_t));
-			if(fileName.find(L".json") != std::wstring::npos && (pNotify->Action == FILE_ACTION_MODIFIED || pNotify->Action == FILE_ACTION_ADDED || pNotify->Action == FILE_ACTION_RENAMED_NEW_NAME)){
-				DriverLog("Distortion profile changed, reloading...");
-				ParseConfig();
-			}
-		}while(pNotify->NextEntryOffset != 0);
-		std::this_thread::sleep_for(std::chrono::milliseconds(200));
-	}
+	});
 }
 				
 // only define settings that most users will change and are unlikely to have their default changed
@@ -176,40 +272,140 @@ void ConfigLoader::Start(){
 		return;
 	}
 	started = true;
+	// manual reset so every watcher sees it
+	stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
 	
-	try{
-		// create directory
-		std::filesystem::create_directories(GetConfigFolder());
+	// load config for the first time, this is the only step needed before the headset can be activated
+	// if settings.json does not exist yet the defaults are used until StartWatchers creates it
+	ParseConfig();
+}
+
+void ConfigLoader::StartWatchers(){
+	// none of this is needed for activation so it is done on a worker to keep it off the startup path
+	driverWorkerPool.Submit("ConfigLoader::StartWatchers", WorkerPriorityNormal, [this](WorkerJob& job){
+		try{
+			// create directory
+			std::filesystem::create_directories(GetConfigFolder());
+			
+			// create default config if it doesn't exist
+			std::string configPath = GetConfigFolder() + "settings.json";
+			if(!std::filesystem::exists(configPath)){
+				std::ofstream configFile(configPath);
+				configFile << defaultConfig;
+				configFile.close();
+			}
+		}catch(const std::exception& e){
+			DriverLog("Failed to create settings.json %s", e.what());
+		}
 		
-		// create default config if it doesn't exist
-		std::string configPath = GetConfigFolder() + "settings.json";
-		if(!std::filesystem::exists(configPath)){
-			std::ofstream configFile(configPath);
-			configFile << defaultConfig;
-			configFile.close();
+		try{
+			// create distortion profiles directory and index the profiles in it
+			std::filesystem::create_directories(GetConfigFolder() + "Distortion/");
+			UpdateDistortionProfileIndex();
+			
+			// a reload job can be replacing driverConfig at the same time
+			bool watchDistortionProfiles;
+			{
+				std::lock_guard<std::mutex> configGuard(driverConfigLock);
+				watchDistortionProfiles = driverConfig.watchDistortionProfiles;
+			}
+			std::lock_guard<std::mutex> guard(watcherLock);
+			if(!started){
+				return;
+			}
+			// start watcher thread, it is joined in Stop
+			watcherThread = std::thread(&ConfigLoader::WatcherThread, this);
+			// watch distortion profiles if configured
+			if(watchDistortionProfiles){
+				distortionWatcherThread = std::thread(&ConfigLoader::WatcherThreadDistortions, this);
+			}
+		}catch(const std::exception& e){
+			DriverLog("Failed to start config watcher: %s", e.what());
+		}
+	});
+}
+
+void ConfigLoader::UpdateDistortionProfileIndex(){
+	std::map<std::string, double> newIndex;
+	std::string distortionPath = GetConfigFolder() + "Distortion/";
+	try{
+		for(const auto& entry : std::filesystem::directory_iterator(distortionPath)){
+			if(entry.is_regular_file() && entry.path().extension() == ".json"){
+				double modifiedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.last_write_time().time_since_epoch()).count() / 1000000000.0;
+				newIndex[entry.path().stem().string()] = modifiedTime;
+			}
 		}
 	}catch(const std::exception& e){
-		DriverLog("Failed to create settings.json %s", e.what());
+		DriverLog("Failed to index distortion profiles: %s", e.what());
+		return;
 	}
-	
-	// load config for the first time
-	ParseConfig();
-	
-	try{	
-		// start watcher thread
-		std::thread watcher(&ConfigLoader::WatcherThread, this);
-		// detach the thread to run forever
-		watcher.detach();
-		
-		// create distortion profiles directory and watch if configured
-		std::filesystem::create_directories(GetConfigFolder() + "Distortion/");
-		if(driverConfig.watchDistortionProfiles){
-			std::thread distortionWatcher(&ConfigLoader::WatcherThreadDistortions, this);
-			distortionWatcher.detach();
+	size_t indexBytes = 0;
+	for(auto& entry : newIndex){
+		indexBytes += memoryTreeNodeOverhead + sizeof(entry) + entry.first.capacity();
+	}
+	std::lock_guard<std::mutex> guard(distortionProfileIndexLock);
+	if(newIndex.size() != distortionProfileIndex.size()){
+		DriverLog("Found %d distortion profiles in %s", (int)newIndex.size(), distortionPath.c_str());
+	}
+	distortionProfileIndex = newIndex;
+	distortionProfileIndexMemory.Resize(indexBytes, newIndex.size());
+}
+
+std::map<std::string, double> ConfigLoader::GetDistortionProfileIndex(){
+	std::lock_guard<std::mutex> guard(distortionProfileIndexLock);
+	return distortionProfileIndex;
+}
+
+bool ConfigLoader::GetIndexedModifiedTime(const std::string& name, double& modifiedTime){
+	std::lock_guard<std::mutex> guard(distortionProfileIndexLock);
+	auto indexed = distortionProfileIndex.find(name);
+	if(indexed == distortionProfileIndex.end()){
+		return false;
+	}
+	modifiedTime = indexed->second;
+	return true;
+}
+
+void ConfigLoader::ReloadConfig(){
+	if(watchersPaused){
+		changedWhilePaused = true;
+		return;
+	}
+	// parse on a worker so the watcher can go back to waiting for changes
+	driverWorkerPool.Submit("ConfigLoader::ParseConfig", WorkerPriorityNormal, [this](WorkerJob& job){
+		// profiles may have been edited without the distortion watcher running, the shims read them after this config
+		UpdateDistortionProfileIndex();
+		ParseConfig();
+	});
+}
+
+void ConfigLoader::PauseWatchers(){
+	watchersPaused = true;
+}
+
+void ConfigLoader::ResumeWatchers(){
+	watchersPaused = false;
+	if(changedWhilePaused.exchange(false)){
+		DriverLog("Config changed during standby, reloading...");
+		ReloadConfig();
+	}
+}
+
+void ConfigLoader::Stop(){
+	if(!started){
+		return;
+	}
+	std::lock_guard<std::mutex> guard(watcherLock);
+	started = false;
+	// wakes the watchers wherever they are, waiting for changes or between them
+	SetEvent(stopEvent);
+	for(std::thread* watcher : {&watcherThread, &distortionWatcherThread}){
+		if(watcher->joinable()){
+			watcher->join();
 		}
-	}catch(const std::exception& e){
-		DriverLog("Failed to start config watcher: %s", e.what());
 	}
+	CloseHandle(stopEvent);
+	stopEvent = nullptr;
 }
 
 
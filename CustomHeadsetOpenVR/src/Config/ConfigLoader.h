@@ -2,26 +2,62 @@
 #include "Config.h"
 #include <string>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <functional>
 
 
 // This class loads config files and watches for changes to them, updating the global config object as needed.
 class ConfigLoader{
 public:
-	bool started = false;
+	std::atomic<bool> started = false;
 	// parse the config file into the global config object
 	void ParseConfig();
 	// load a distortion profile config from disk
 	DistortionProfileConfig ParseDistortionConfig(std::string name);
-	// start the config parser
+	// load a distortion profile config from a json file at any path, name is used as the profile name
+	DistortionProfileConfig ParseDistortionConfigFile(std::string profilePath, std::string name);
+	// start the config parser and load the config
 	void Start();
+	// create the config directories and default settings and start watching for changes on a worker thread
+	void StartWatchers();
+	// stop and join the watcher threads
+	void Stop();
+	// parse the config file again on a worker thread
+	void ReloadConfig();
+	// ignore file changes while in standby, changes made while paused are loaded when resumed
+	void PauseWatchers();
+	void ResumeWatchers();
 	// thread to watch for file changes
 	void WatcherThread();
 	// thread for watching distortions if enabled
 	void WatcherThreadDistortions();
+	// call onChange with the name of each file added, renamed or modified in path until Stop is called
+	// the name is empty if changes were lost because too many happened at once
+	void WatchDirectory(const std::string& path, std::function<void(const std::wstring&)> onChange);
 	// get folder with trailin slash for config files
 	std::string GetConfigFolder();
+	// rescan the distortion directory for profiles
+	void UpdateDistortionProfileIndex();
+	// get the names of profiles in the distortion directory and their modified times
+	std::map<std::string, double> GetDistortionProfileIndex();
+	// modified time of a profile in the distortion directory as of the last scan, returns false if it was not found
+	bool GetIndexedModifiedTime(const std::string& name, double& modifiedTime);
 private:
 	bool hasLoggedConfigFileNotFound = false;
+	std::thread watcherThread;
+	std::thread distortionWatcherThread;
+	// set by Stop to wake the watchers
+	void* stopEvent = nullptr;
+	std::atomic<bool> watchersPaused = false;
+	std::atomic<bool> changedWhilePaused = false;
+	// prevents watchers from starting while stopping
+	std::mutex watcherLock;
+	std::map<std::string, double> distortionProfileIndex;
+	TrackedMemory distortionProfileIndexMemory{MemorySubsystemConfig, 0, 0};
+	std::mutex distortionProfileIndexLock;
 };
 
 // global config loader object, used to load config files and watch for changes
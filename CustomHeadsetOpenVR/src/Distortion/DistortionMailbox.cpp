@@ -0,0 +1,159 @@
+#include "DistortionMailbox.h"
+#include "../Driver/DriverLog.h"
+#include "Windows.h"
+#include <atomic>
+#include <cstring>
+
+
+bool DistortionMailbox::Open(){
+	if(block != nullptr){
+		return true;
+	}
+	// whichever of the driver or the tool creates the block first gets zeroed memory, the other opens the same block
+	HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(DistortionMailboxBlock), DISTORTION_MAILBOX_NAME);
+	if(handle == NULL){
+		DriverLog("Failed to create distortion mailbox: %d", (int)GetLastError());
+		return false;
+	}
+	void* view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(DistortionMailboxBlock));
+	if(view == NULL){
+		DriverLog("Failed to map distortion mailbox: %d", (int)GetLastError());
+		CloseHandle(handle);
+		return false;
+	}
+	mapping = handle;
+	block = (DistortionMailboxBlock*)view;
+	if(block->magic == 0){
+		block->version = distortionMailboxVersion;
+		block->size = sizeof(DistortionMailboxBlock);
+		std::atomic_thread_fence(std::memory_order_release);
+		block->magic = distortionMailboxMagic;
+	}
+	// only pick up profiles published after opening
+	lastGeneration = block->generation;
+	hasLoggedVersionMismatch = false;
+	DriverLog("Opened distortion mailbox %s", DISTORTION_MAILBOX_NAME);
+	return true;
+}
+
+void DistortionMailbox::Close(){
+	if(block != nullptr){
+		UnmapViewOfFile(block);
+		block = nullptr;
+	}
+	if(mapping != nullptr){
+		CloseHandle((HANDLE)mapping);
+		mapping = nullptr;
+	}
+}
+
+bool DistortionMailbox::IsOpen(){
+	return block != nullptr;
+}
+
+// copy a curve from the mailbox, the count is clamped in case the tool wrote garbage
+static std::vector<double> CopyCurve(const double* points, uint32_t count){
+	if(count > distortionMailboxMaxPoints){
+		count = distortionMailboxMaxPoints;
+	}
+	return std::vector<double>(points, points + count * 2);
+}
+
+bool DistortionMailbox::Poll(DistortionProfileConfig& config){
+	if(block == nullptr){
+		return false;
+	}
+	uint32_t generation = block->generation;
+	if(generation == lastGeneration){
+		return false;
+	}
+	if(block->magic != distortionMailboxMagic || block->version != distortionMailboxVersion || block->size != sizeof(DistortionMailboxBlock)){
+		if(!hasLoggedVersionMismatch){
+			DriverLog("Distortion mailbox was written with an unsupported layout, version %u size %u", block->version, block->size);
+			hasLoggedVersionMismatch = true;
+		}
+		lastGeneration = generation;
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	// copy the slot and check that the tool did not start writing to it while copying
+	// if it did this generation is skipped and the newer one is picked up on a later frame
+	DistortionMailboxSlot& slot = block->slots[generation % 2];
+	uint32_t sequenceBefore = slot.sequence;
+	if(sequenceBefore % 2 != 0){
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	char name[sizeof(slot.name)];
+	char type[sizeof(slot.type)];
+	memcpy(name, slot.name, sizeof(name));
+	memcpy(type, slot.type, sizeof(type));
+	name[sizeof(name) - 1] = 0;
+	type[sizeof(type) - 1] = 0;
+	std::vector<double> distortions = CopyCurve(slot.distortions, slot.distortionsCount);
+	std::vector<double> distortionsRed = CopyCurve(slot.distortionsRed, slot.distortionsRedCount);
+	std::vector<double> distortionsBlue = CopyCurve(slot.distortionsBlue, slot.distortionsBlueCount);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if(slot.sequence != sequenceBefore){
+		return false;
+	}
+	lastGeneration = generation;
+
+	config = {};
+	config.name = std::string("Mailbox ") + name;
+	config.description = "Distortion profile pushed through the distortion mailbox";
+	// the generation is used as the modified time so every push counts as a change
+	config.modifiedTime = generation;
+	config.type = type;
+	config.distortions = distortions;
+	config.distortionsRed = distortionsRed;
+	config.distortionsBlue = distortionsBlue;
+	return true;
+}
+
+// copy a curve into the mailbox, the caller has checked that it fits
+static void WriteCurve(const std::vector<double>& curve, double* points, uint32_t& count){
+	if(!curve.empty()){
+		memcpy(points, curve.data(), curve.size() * sizeof(double));
+	}
+	count = (uint32_t)(curve.size() / 2);
+}
+
+bool DistortionMailbox::Publish(const DistortionProfileConfig& config){
+	if(block == nullptr){
+		return false;
+	}
+	if(block->magic != distortionMailboxMagic || block->version != distortionMailboxVersion || block->size != sizeof(DistortionMailboxBlock)){
+		DriverLog("Distortion mailbox was created with an unsupported layout, version %u size %u", block->version, block->size);
+		return false;
+	}
+	if(config.distortions.size() > distortionMailboxMaxPoints * 2 || config.distortionsRed.size() > distortionMailboxMaxPoints * 2 || config.distortionsBlue.size() > distortionMailboxMaxPoints * 2){
+		DriverLog("Distortion profile %s has more than %d points in a curve", config.name.c_str(), distortionMailboxMaxPoints);
+		return false;
+	}
+
+	// write the slot that is not published so the driver can keep reading the published one
+	uint32_t generation = block->generation + 1;
+	DistortionMailboxSlot& slot = block->slots[generation % 2];
+	slot.sequence = slot.sequence + 1;
+	std::atomic_thread_fence(std::memory_order_release);
+	memset(slot.name, 0, sizeof(slot.name));
+	memset(slot.type, 0, sizeof(slot.type));
+	strncpy(slot.name, config.name.c_str(), sizeof(slot.name) - 1);
+	strncpy(slot.type, config.type.c_str(), sizeof(slot.type) - 1);
+	WriteCurve(config.distortions, slot.distortions, slot.distortionsCount);
+	WriteCurve(config.distortionsRed, slot.distortionsRed, slot.distortionsRedCount);
+	WriteCurve(config.distortionsBlue, slot.distortionsBlue, slot.distortionsBlueCount);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.sequence = slot.sequence + 1;
+	std::atomic_thread_fence(std::memory_order_release);
+	block->generation = generation;
+	// a tool polling its own mailbox should not receive what it published
+	lastGeneration = generation;
+	return true;
+}
+
+DistortionMailbox::~DistortionMailbox(){
+	Close();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "../Config/Config.h"
+#include <cstdint>
+
+
+// name of the shared memory block that calibration tools write distortion curves to
+#define DISTORTION_MAILBOX_NAME "Local\\CustomHeadsetOpenVRDistortionMailbox"
+// 'CHDM'
+static const uint32_t distortionMailboxMagic = 0x4d444843;
+// increment when the layout of DistortionMailboxBlock changes
+static const uint32_t distortionMailboxVersion = 1;
+// maximum number of control points in each curve
+static const int distortionMailboxMaxPoints = 64;
+
+// layout of the shared memory block, this is shared with calibration tools so it must only contain plain data
+// the block is double buffered so the tool can write the next profile while the driver reads the last one
+// to publish a profile a tool must:
+// - pick the slot that is not published, slots[(generation + 1) % 2]
+// - increment the slot sequence to an odd number, write the slot, then increment the sequence to an even number
+// - increment generation
+#pragma pack(push, 8)
+struct DistortionMailboxSlot{
+	// odd while the slot is being written
+	volatile uint32_t sequence;
+	// number of control point pairs in each curve
+	uint32_t distortionsCount;
+	uint32_t distortionsRedCount;
+	uint32_t distortionsBlueCount;
+	// null terminated name and type as used in distortion profile json files
+	char name[64];
+	char type[32];
+	// pairs of field angle in degrees and panel position in percent, the same as distortion profile json files
+	double distortions[distortionMailboxMaxPoints * 2];
+	double distortionsRed[distortionMailboxMaxPoints * 2];
+	double distortionsBlue[distortionMailboxMaxPoints * 2];
+};
+struct DistortionMailboxBlock{
+	uint32_t magic;
+	uint32_t version;
+	// sizeof(DistortionMailboxBlock)
+	uint32_t size;
+	// incremented each time a slot is published, the published slot is slots[generation % 2]
+	volatile uint32_t generation;
+	DistortionMailboxSlot slots[2];
+};
+#pragma pack(pop)
+
+
+// Receives distortion profiles pushed live by calibration tools through shared memory.
+// This skips the distortion directory watcher and json parsing so tuning a lens is interactive.
+// Tools use the same class with Publish to write profiles.
+class DistortionMailbox{
+public:
+	// create or open the shared memory block, returns false if it could not be mapped
+	bool Open();
+	void Close();
+	bool IsOpen();
+	// check for a newly published profile, this is cheap enough to call every frame
+	// returns true and fills config if a profile was published since the last call
+	bool Poll(DistortionProfileConfig& config);
+	// write config to the unpublished slot and publish it, used by tools
+	// returns false if the block has a different layout or a curve has more than distortionMailboxMaxPoints points
+	bool Publish(const DistortionProfileConfig& config);
+	~DistortionMailbox();
+private:
+	void* mapping = nullptr;
+	DistortionMailboxBlock* block = nullptr;
+	uint32_t lastGeneration = 0;
+	// set if the block was written by a tool with a different layout, so it is only logged once
+	bool hasLoggedVersionMismatch = false;
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// C interface for distortion kernels loaded from shared libraries in the Plugins folder of the config folder.
+// A profile uses a kernel by setting its type to the name of the kernel, the whole profile json is passed to Build,
+// and if the profile has a "blob" string the file with that name in the Distortion folder is passed as well.
+//
+// A plugin exports CUSTOM_HEADSET_DISTORTION_PLUGIN_ENTRY which returns its function table for the abi version of the driver,
+// or NULL if it does not support that version. New fields are only ever added to the end of the table,
+// so a table with a larger structSize than the driver knows about is still accepted.
+//
+// Coordinates are the same as DistortionProfile::ComputeDistortion, -1 to 1 from the lens center on the display.
+// Evaluate and EvaluateInverse may be called from several threads at once after Build has returned.
+// Build, Destroy and ReleaseCaches are never called while the kernel is being evaluated or from two threads at once.
+// Build can be called again on a kernel that was already built, the driver does this before evaluating a kernel after ReleaseCaches.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CUSTOM_HEADSET_DISTORTION_PLUGIN_ABI_VERSION 1
+#define CUSTOM_HEADSET_DISTORTION_PLUGIN_ENTRY "CustomHeadsetGetDistortionPlugin"
+
+// cpu features a plugin can require, the plugin is not loaded if the cpu is missing any of them
+#define CUSTOM_HEADSET_CPU_SSE2 0x1
+#define CUSTOM_HEADSET_CPU_SSE41 0x2
+#define CUSTOM_HEADSET_CPU_AVX 0x4
+#define CUSTOM_HEADSET_CPU_AVX2 0x8
+#define CUSTOM_HEADSET_CPU_FMA 0x10
+#define CUSTOM_HEADSET_CPU_AVX512F 0x20
+
+// eyes and channels use the values of vr::EVREye and ColorChannel
+#define CUSTOM_HEADSET_EYE_LEFT 0
+#define CUSTOM_HEADSET_EYE_RIGHT 1
+#define CUSTOM_HEADSET_CHANNEL_RED 0
+#define CUSTOM_HEADSET_CHANNEL_GREEN 1
+#define CUSTOM_HEADSET_CHANNEL_BLUE 2
+
+// state of a kernel, owned by the plugin
+typedef struct CustomHeadsetDistortionKernel CustomHeadsetDistortionKernel;
+
+typedef struct CustomHeadsetDistortionPlugin{
+	// CUSTOM_HEADSET_DISTORTION_PLUGIN_ABI_VERSION the plugin was built with
+	uint32_t abiVersion;
+	// sizeof(CustomHeadsetDistortionPlugin) the plugin was built with
+	uint32_t structSize;
+	// profile type this kernel handles
+	const char* name;
+	// CUSTOM_HEADSET_CPU_ flags the kernel needs
+	uint32_t requiredCpuFeatures;
+
+	CustomHeadsetDistortionKernel* (*Create)(void);
+	void (*Destroy)(CustomHeadsetDistortionKernel* kernel);
+	// build the kernel from the profile json and the optional blob, resolution is the width of one eye in pixels
+	// returns 0 on success, the message of a failure can be written to error which has room for errorSize characters
+	int (*Build)(CustomHeadsetDistortionKernel* kernel, const char* json, size_t jsonSize, const void* blob, size_t blobSize, float resolution, char* error, size_t errorSize);
+	// distort count points given as separate arrays of u and v, writing where each is sampled from in the input image
+	void (*Evaluate)(CustomHeadsetDistortionKernel* kernel, uint32_t eye, uint32_t channel, const float* u, const float* v, float* outU, float* outV, uint32_t count);
+	// inverse of Evaluate, may be NULL if the kernel has no inverse
+	void (*EvaluateInverse)(CustomHeadsetDistortionKernel* kernel, uint32_t eye, uint32_t channel, const float* u, const float* v, float* outU, float* outV, uint32_t count);
+	// tangents of the half angles of the input image, with the same order as DistortionProfile::GetProjectionRaw
+	void (*GetProjectionRaw)(CustomHeadsetDistortionKernel* kernel, uint32_t eye, float* left, float* right, float* bottom, float* top);
+	// bytes used by lookup tables and other caches, may be NULL
+	size_t (*GetCacheMemoryUsage)(CustomHeadsetDistortionKernel* kernel);
+	// free caches while in standby returning the bytes freed, the kernel is not evaluated again until Build has been called, may be NULL
+	size_t (*ReleaseCaches)(CustomHeadsetDistortionKernel* kernel);
+} CustomHeadsetDistortionPlugin;
+
+// signature of CUSTOM_HEADSET_DISTORTION_PLUGIN_ENTRY
+typedef const CustomHeadsetDistortionPlugin* (*CustomHeadsetGetDistortionPluginFunction)(uint32_t driverAbiVersion);
+
+#ifdef __cplusplus
+}
+#endif
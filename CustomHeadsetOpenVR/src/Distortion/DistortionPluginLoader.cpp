@@ -0,0 +1,118 @@
+#include "DistortionPluginLoader.h"
+#include "../Driver/DriverLog.h"
+#include "Windows.h"
+#include <intrin.h>
+#include <filesystem>
+
+
+DistortionPluginLoader driverDistortionPlugins;
+
+uint32_t DistortionPluginLoader::DetectCpuFeatures(){
+	uint32_t features = 0;
+	int registers[4] = {};
+	__cpuid(registers, 0);
+	int maxLeaf = registers[0];
+	__cpuid(registers, 1);
+	if(registers[3] & (1 << 26)){
+		features |= CUSTOM_HEADSET_CPU_SSE2;
+	}
+	if(registers[2] & (1 << 19)){
+		features |= CUSTOM_HEADSET_CPU_SSE41;
+	}
+	// avx registers also need to be saved by the operating system
+	bool osSavesAvx = false;
+	bool osSavesAvx512 = false;
+	if(registers[2] & (1 << 27)){
+		unsigned long long xcr0 = _xgetbv(0);
+		osSavesAvx = (xcr0 & 0x6) == 0x6;
+		osSavesAvx512 = (xcr0 & 0xe6) == 0xe6;
+	}
+	if(osSavesAvx && (registers[2] & (1 << 28))){
+		features |= CUSTOM_HEADSET_CPU_AVX;
+	}
+	if(osSavesAvx && (registers[2] & (1 << 12))){
+		features |= CUSTOM_HEADSET_CPU_FMA;
+	}
+	if(maxLeaf >= 7){
+		__cpuidex(registers, 7, 0);
+		if(osSavesAvx && (registers[1] & (1 << 5))){
+			features |= CUSTOM_HEADSET_CPU_AVX2;
+		}
+		if(osSavesAvx512 && (registers[1] & (1 << 16))){
+			features |= CUSTOM_HEADSET_CPU_AVX512F;
+		}
+	}
+	return features;
+}
+
+bool DistortionPluginLoader::ValidatePlugin(const CustomHeadsetDistortionPlugin* plugin, const std::string& path, uint32_t cpuFeatures){
+	if(plugin == nullptr){
+		DriverLog("Distortion plugin %s does not support abi version %d", path.c_str(), CUSTOM_HEADSET_DISTORTION_PLUGIN_ABI_VERSION);
+		return false;
+	}
+	if(plugin->abiVersion != CUSTOM_HEADSET_DISTORTION_PLUGIN_ABI_VERSION || plugin->structSize < sizeof(CustomHeadsetDistortionPlugin)){
+		DriverLog("Distortion plugin %s was built for abi version %u with a table of %u bytes, the driver needs version %d", path.c_str(), plugin->abiVersion, plugin->structSize, CUSTOM_HEADSET_DISTORTION_PLUGIN_ABI_VERSION);
+		return false;
+	}
+	if(plugin->name == nullptr || plugin->name[0] == 0 || plugin->Create == nullptr || plugin->Destroy == nullptr || plugin->Build == nullptr || plugin->Evaluate == nullptr || plugin->GetProjectionRaw == nullptr){
+		DriverLog("Distortion plugin %s is missing its name or a required function", path.c_str());
+		return false;
+	}
+	std::string name = plugin->name;
+	if(name == "None" || name == "RadialBezier"){
+		DriverLog("Distortion plugin %s can't replace the built in type %s", path.c_str(), name.c_str());
+		return false;
+	}
+	uint32_t missingFeatures = plugin->requiredCpuFeatures & ~cpuFeatures;
+	if(missingFeatures != 0){
+		DriverLog("Distortion plugin %s needs cpu features 0x%x that this cpu does not have", path.c_str(), missingFeatures);
+		return false;
+	}
+	if(plugins.find(name) != plugins.end()){
+		DriverLog("Distortion plugin %s has the same type %s as a plugin that is already loaded", path.c_str(), name.c_str());
+		return false;
+	}
+	return true;
+}
+
+void DistortionPluginLoader::LoadPlugins(const std::string& folder){
+	std::error_code error;
+	if(!std::filesystem::is_directory(folder, error)){
+		return;
+	}
+	uint32_t cpuFeatures = DetectCpuFeatures();
+	std::lock_guard<std::mutex> guard(lock);
+	for(const auto& entry : std::filesystem::directory_iterator(folder, error)){
+		if(!entry.is_regular_file() || entry.path().extension() != ".dll"){
+			continue;
+		}
+		std::string path = entry.path().string();
+		HMODULE module = LoadLibraryA(path.c_str());
+		if(module == NULL){
+			DriverLog("Failed to load distortion plugin %s: %d", path.c_str(), (int)GetLastError());
+			continue;
+		}
+		CustomHeadsetGetDistortionPluginFunction getPlugin = (CustomHeadsetGetDistortionPluginFunction)GetProcAddress(module, CUSTOM_HEADSET_DISTORTION_PLUGIN_ENTRY);
+		if(getPlugin == nullptr){
+			DriverLog("%s does not export %s", path.c_str(), CUSTOM_HEADSET_DISTORTION_PLUGIN_ENTRY);
+			FreeLibrary(module);
+			continue;
+		}
+		const CustomHeadsetDistortionPlugin* plugin = getPlugin(CUSTOM_HEADSET_DISTORTION_PLUGIN_ABI_VERSION);
+		if(!ValidatePlugin(plugin, path, cpuFeatures)){
+			FreeLibrary(module);
+			continue;
+		}
+		plugins[plugin->name] = plugin;
+		DriverLog("Loaded distortion plugin %s for type %s", path.c_str(), plugin->name);
+	}
+}
+
+const CustomHeadsetDistortionPlugin* DistortionPluginLoader::Find(const std::string& type){
+	std::lock_guard<std::mutex> guard(lock);
+	auto plugin = plugins.find(type);
+	if(plugin == plugins.end()){
+		return nullptr;
+	}
+	return plugin->second;
+}
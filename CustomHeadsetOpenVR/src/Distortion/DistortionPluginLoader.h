@@ -0,0 +1,28 @@
+#pragma once
+#include "DistortionPluginApi.h"
+#include <string>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+
+// Loads distortion kernels from shared libraries and finds them by profile type.
+// Plugins stay loaded until the driver is unloaded since profiles built from them can live until then.
+class DistortionPluginLoader{
+public:
+	// load every dll in folder that exports CUSTOM_HEADSET_DISTORTION_PLUGIN_ENTRY
+	// plugins with an unsupported abi version, missing functions or cpu features this cpu lacks are skipped
+	void LoadPlugins(const std::string& folder);
+	// plugin for a profile type, nullptr if there is none
+	const CustomHeadsetDistortionPlugin* Find(const std::string& type);
+	// CUSTOM_HEADSET_CPU_ flags supported by this cpu and operating system
+	static uint32_t DetectCpuFeatures();
+private:
+	// check that a plugin can be used, logs the reason if not
+	bool ValidatePlugin(const CustomHeadsetDistortionPlugin* plugin, const std::string& path, uint32_t cpuFeatures);
+	std::map<std::string, const CustomHeadsetDistortionPlugin*> plugins;
+	std::mutex lock;
+};
+
+// global plugin loader
+extern DistortionPluginLoader driverDistortionPlugins;
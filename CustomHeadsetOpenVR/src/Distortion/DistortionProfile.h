@@ -1,5 +1,6 @@
 #pragma once
 #include "openvr_driver.h"
+#include "../Driver/MemoryAccounting.h"
 
 enum ColorChannel{
 	ColorChannelRed,
@@ -23,8 +24,31 @@ public:
 	// this means they can be largest than 1 in the larger dimension of the screen
 	// that is not how this function is normally called in the openvr apis 
 	virtual Point2D ComputeDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV) = 0;
+	// ComputeDistortion for count points given as separate arrays of u and v
+	// profiles that can evaluate many points faster at once override this
+	virtual void ComputeDistortionBatch(vr::EVREye eEye, ColorChannel colorChannel, const float* fU, const float* fV, float* outU, float* outV, uint32_t count){
+		for(uint32_t i = 0; i < count; i++){
+			Point2D distortion = ComputeDistortion(eEye, colorChannel, fU[i], fV[i]);
+			outU[i] = distortion.x;
+			outV[i] = distortion.y;
+		}
+	};
 	// returns the raw projection details
 	// the values are tangents of the half-angle from center axis
 	// the top and bottom seemed to be reversed in the official documentation so the order is different here to correct that
 	virtual void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfBottom, float* pfTop) = 0;
+	// the inverse of ComputeDistortion, maps a point in the input image back to where it is shown on the output
+	// returns false if the profile does not support an inverse
+	virtual bool ComputeInverseDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, Point2D& result){return false;};
+	// bytes of memory used by caches such as lookup tables
+	virtual size_t GetCacheMemoryUsage(){return 0;};
+	// free caches to save memory while they are not needed, this must not be called while the profile can be evaluated
+	// Initialize must be called again before the profile is evaluated, DistortionProfileConstructor only does this for profiles that are not in use
+	// returns the number of bytes freed
+	virtual size_t ReleaseCaches(){return 0;};
+	// profiles are deleted through this class so derived destructors must be called
+	virtual ~DistortionProfile(){};
+protected:
+	// derived profiles resize this as they build and release their caches
+	TrackedMemory trackedMemory{MemorySubsystemDistortion, sizeof(DistortionProfile)};
 };
\ No newline at end of file
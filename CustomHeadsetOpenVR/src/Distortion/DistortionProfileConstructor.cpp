@@ -1,7 +1,11 @@
 #include "DistortionProfileConstructor.h"
 #include "RadialBezierDistortionProfile.h"
+#include "PluginDistortionProfile.h"
+#include "DistortionPluginLoader.h"
+#include "../Driver/FlightRecorder.h"
+#include <chrono>
 
-bool DistortionProfileConstructor::LoadDistortionProfile(std::string name){
+DistortionProfileConfig DistortionProfileConstructor::GetProfileConfig(std::string name){
 	
 	DistortionProfileConfig config = {};
 	
@@ -40,19 +44,31 @@ bool DistortionProfileConstructor::LoadDistortionProfile(std::string name){
 	}
 	
 	if(config.name == "None"){
+		// a file that has not changed since it was read for the current or a cached profile is not read again
+		double indexedModifiedTime = 0;
+		if(driverConfigLoader.GetIndexedModifiedTime(name, indexedModifiedTime)){
+			std::lock_guard<std::mutex> guard(pendingLock);
+			if(profileConfig.name == name && profileConfig.modifiedTime == indexedModifiedTime){
+				return profileConfig;
+			}
+			auto cached = profileCache.find(name);
+			if(cached != profileCache.end() && cached->second.config.modifiedTime == indexedModifiedTime){
+				return cached->second.config;
+			}
+		}
 		DistortionProfileConfig configFromDisk = driverConfigLoader.ParseDistortionConfig(name);
 		if(configFromDisk.name != "None"){
 			config = configFromDisk;
 		}
 	}
 	
-	
-	// check if the profile has not changed to avoid recreating it
-	if(profile != nullptr && config.name == profileName && config.modifiedTime == profileModifiedTime){
-		return false;
-	}
-	
+	return config;
+}
+
+DistortionProfile* DistortionProfileConstructor::BuildProfile(const DistortionProfileConfig& config){
 	DistortionProfile* newProfile = nullptr;
+	driverFlightRecorder.Record(FlightRecorderProfileBuildStart, config.name.c_str());
+	auto buildStart = std::chrono::steady_clock::now();
 		
 	// construct RadialBezierDistortionProfile object from config
 	if(config.type == "RadialBezier"){
@@ -76,37 +92,296 @@ bool DistortionProfileConstructor::LoadDistortionProfile(std::string name){
 			}
 		}
 		newProfile = radialBezierProfile;
+	}else if(const CustomHeadsetDistortionPlugin* plugin = driverDistortionPlugins.Find(config.type)){
+		newProfile = new PluginDistortionProfile(plugin, config);
+	}else if(config.type != "None"){
+		DriverLog("Unknown distortion type %s in profile %s", config.type.c_str(), config.name.c_str());
 	}
 	
-	bool changed = false;
-	
 	if(newProfile != nullptr){
 		// copy settings to new distortion profile
 		newProfile->resolution = distortionSettings.resolution;
-		// initialize new profile and replace old one
 		newProfile->Initialize();
-		if(profile != nullptr && profile != &distortionSettings){
-			delete profile;
+		// fall back to the default profile if a plugin failed to build
+		PluginDistortionProfile* pluginProfile = dynamic_cast<PluginDistortionProfile*>(newProfile);
+		if(pluginProfile != nullptr && !pluginProfile->IsBuilt()){
+			delete newProfile;
+			newProfile = nullptr;
 		}
+	}
+	int64_t buildMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - buildStart).count();
+	driverFlightRecorder.Record(FlightRecorderProfileBuildEnd, config.name.c_str(), buildMicroseconds);
+	return newProfile;
+}
+
+DistortionProfile* DistortionProfileConstructor::TakeCachedProfile(const DistortionProfileConfig& config){
+	auto cached = profileCache.find(config.name);
+	if(cached == profileCache.end()){
+		return nullptr;
+	}
+	if(cached->second.config.modifiedTime != config.modifiedTime){
+		// the file has changed since it was cached
+		delete cached->second.profile;
+		profileCache.erase(cached);
+		return nullptr;
+	}
+	DistortionProfile* cachedProfile = cached->second.profile;
+	profileCache.erase(cached);
+	return cachedProfile;
+}
+
+bool DistortionProfileConstructor::ReplaceProfile(DistortionProfile* newProfile, const DistortionProfileConfig& config){
+	bool changed = false;
+	
+	// the compositor can still be evaluating the old profile on other threads until it has rebuilt its mesh
+	// so it is retired and only cached or deleted by ReleaseRetiredProfiles once that has had time to happen
+	DistortionProfile* oldProfile = profile != &distortionSettings ? profile : nullptr;
+	if(oldProfile != nullptr){
+		RetiredProfile& retired = retiredProfiles.emplace_back();
+		retired.profile = oldProfile;
+		retired.config = profileConfig;
+		retired.retireTime = std::chrono::steady_clock::now();
+	}
+	
+	if(newProfile != nullptr){
 		profile = newProfile;
 		changed = true;
 	}
 	
 	// fallback to default profile if nothing was set
-	if(newProfile == nullptr && profile != &distortionSettings){
-		if(profile != nullptr){
-			delete profile;
-		}
+	if(newProfile == nullptr && oldProfile != nullptr){
 		profile = &distortionSettings;
 		changed = true;
 	}
 	
-	profileName = config.name;
-	profileModifiedTime = config.modifiedTime;
+	profileConfig = config;
 	return changed;
 }
 
+bool DistortionProfileConstructor::LoadDistortionProfile(std::string name){
+	DistortionProfileConfig config = GetProfileConfig(name);
+	
+	std::lock_guard<std::mutex> guard(pendingLock);
+	// check if the profile has not changed to avoid recreating it
+	if(profile != nullptr && config.name == profileConfig.name && config.modifiedTime == profileConfig.modifiedTime){
+		return false;
+	}
+	return ReplaceProfile(BuildProfile(config), config);
+}
+
+bool DistortionProfileConstructor::LoadDistortionProfile(const DistortionProfileConfig& config){
+	std::lock_guard<std::mutex> guard(pendingLock);
+	return ReplaceProfile(BuildProfile(config), config);
+}
+
+void DistortionProfileConstructor::LoadDistortionProfileAsync(std::string name, WorkerPriority priority, bool force){
+	StartProfileJob(priority, force, [this, name](){
+		return GetProfileConfig(name);
+	});
+}
+
+void DistortionProfileConstructor::LoadDistortionProfileAsync(const DistortionProfileConfig& config, WorkerPriority priority){
+	StartProfileJob(priority, true, [config](){
+		return config;
+	});
+}
+
+void DistortionProfileConstructor::StartProfileJob(WorkerPriority priority, bool force, std::function<DistortionProfileConfig()> getConfig){
+	std::lock_guard<std::mutex> guard(pendingLock);
+	// a newer request replaces any profile that is still being built
+	if(pendingJob != nullptr){
+		pendingJob->Cancel();
+	}
+	pendingJob = driverWorkerPool.Submit("DistortionProfileConstructor::LoadDistortionProfile", priority, [this, getConfig, force](WorkerJob& job){
+		DistortionProfileConfig config = getConfig();
+		DistortionProfile* newProfile = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(pendingLock);
+			if(job.IsCancelled() || (!force && config.name == profileConfig.name && config.modifiedTime == profileConfig.modifiedTime)){
+				return;
+			}
+			// use a prebuilt profile if there is one
+			newProfile = TakeCachedProfile(config);
+		}
+		if(newProfile == nullptr){
+			newProfile = BuildProfile(config);
+		}else if(newProfile->GetCacheMemoryUsage() == 0){
+			// its caches were released during standby
+			newProfile->Initialize();
+		}
+		std::lock_guard<std::mutex> guard(pendingLock);
+		if(job.IsCancelled()){
+			delete newProfile;
+			return;
+		}
+		if(pendingProfile != nullptr){
+			delete pendingProfile;
+		}
+		pendingProfile = newProfile;
+		pendingConfig = config;
+		pendingReady = true;
+	});
+}
+
+bool DistortionProfileConstructor::ApplyPendingProfile(){
+	// avoid taking the lock every frame when nothing is waiting
+	if(!pendingReady){
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(pendingLock);
+	pendingReady = false;
+	DistortionProfile* newProfile = pendingProfile;
+	pendingProfile = nullptr;
+	return ReplaceProfile(newProfile, pendingConfig);
+}
+
+void DistortionProfileConstructor::ReleaseRetiredProfiles(){
+	if(retiredProfiles.empty()){
+		return;
+	}
+	std::lock_guard<std::mutex> guard(pendingLock);
+	auto now = std::chrono::steady_clock::now();
+	// profiles are retired in order so the oldest are first
+	size_t released = 0;
+	for(; released < retiredProfiles.size(); released++){
+		RetiredProfile& retired = retiredProfiles[released];
+		if(std::chrono::duration<double>(now - retired.retireTime).count() < retiredProfileSeconds){
+			break;
+		}
+		// keep it in the cache if it is wanted there, otherwise delete it
+		if(cachedProfileNames.count(retired.config.name) > 0 && profileCache.count(retired.config.name) == 0 && retired.config.name != profileConfig.name){
+			CachedProfile& cached = profileCache[retired.config.name];
+			cached.profile = retired.profile;
+			cached.config = retired.config;
+		}else{
+			delete retired.profile;
+		}
+	}
+	retiredProfiles.erase(retiredProfiles.begin(), retiredProfiles.begin() + released);
+}
+
+void DistortionProfileConstructor::WaitForPendingProfile(){
+	WorkerJobHandle job = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		job = pendingJob;
+	}
+	if(job != nullptr){
+		job->Wait();
+	}
+}
+
+void DistortionProfileConstructor::PrebuildProfiles(const std::vector<std::string>& names){
+	std::lock_guard<std::mutex> guard(pendingLock);
+	cachedProfileNames = std::set<std::string>(names.begin(), names.end());
+	// drop profiles that are no longer wanted
+	for(auto cached = profileCache.begin(); cached != profileCache.end();){
+		if(cachedProfileNames.count(cached->first) == 0){
+			delete cached->second.profile;
+			cached = profileCache.erase(cached);
+		}else{
+			cached++;
+		}
+	}
+	for(size_t i = 0; i < prebuildJobs.size();){
+		if(prebuildJobs[i]->IsFinished()){
+			prebuildJobs.erase(prebuildJobs.begin() + i);
+		}else{
+			i++;
+		}
+	}
+	for(const std::string& name : cachedProfileNames){
+		prebuildJobs.push_back(driverWorkerPool.Submit("DistortionProfileConstructor::PrebuildProfile", WorkerPriorityIdle, [this, name](WorkerJob& job){
+			DistortionProfileConfig config = GetProfileConfig(name);
+			DistortionProfile* newProfile = nullptr;
+			{
+				std::lock_guard<std::mutex> guard(pendingLock);
+				if(job.IsCancelled() || cachedProfileNames.count(config.name) == 0){
+					return;
+				}
+				// nothing to build if it is the current profile or is already cached and unchanged
+				if(config.name == profileConfig.name && config.modifiedTime == profileConfig.modifiedTime){
+					return;
+				}
+				auto cached = profileCache.find(config.name);
+				if(cached != profileCache.end() && cached->second.config.modifiedTime == config.modifiedTime){
+					if(cached->second.profile->GetCacheMemoryUsage() != 0){
+						return;
+					}
+					// its caches were released during standby, rebuild them outside of the cache
+					newProfile = cached->second.profile;
+					profileCache.erase(cached);
+				}
+			}
+			if(newProfile != nullptr){
+				newProfile->Initialize();
+			}else{
+				newProfile = BuildProfile(config);
+			}
+			if(newProfile == nullptr){
+				return;
+			}
+			std::lock_guard<std::mutex> guard(pendingLock);
+			if(job.IsCancelled() || cachedProfileNames.count(config.name) == 0 || config.name == profileConfig.name){
+				delete newProfile;
+				return;
+			}
+			auto cached = profileCache.find(config.name);
+			if(cached != profileCache.end()){
+				delete cached->second.profile;
+			}
+			profileCache[config.name] = {newProfile, config};
+		}));
+	}
+}
+
+void DistortionProfileConstructor::CancelJobs(){
+	// jobs take the lock so wait for them without holding it
+	std::vector<WorkerJobHandle> jobs;
+	{
+		std::lock_guard<std::mutex> guard(pendingLock);
+		jobs = prebuildJobs;
+		prebuildJobs.clear();
+		if(pendingJob != nullptr){
+			jobs.push_back(pendingJob);
+		}
+	}
+	for(WorkerJobHandle& job : jobs){
+		job->Cancel();
+		job->Wait();
+	}
+}
+
+size_t DistortionProfileConstructor::ReleaseCaches(){
+	CancelJobs();
+	std::lock_guard<std::mutex> guard(pendingLock);
+	size_t released = 0;
+	if(pendingProfile != nullptr){
+		released += pendingProfile->GetCacheMemoryUsage();
+		delete pendingProfile;
+		pendingProfile = nullptr;
+		pendingReady = false;
+	}
+	// the current and retired profiles are left alone since the compositor can be evaluating them on other threads
+	// cached profiles are kept but rebuild their caches before they are switched to
+	for(auto& cached : profileCache){
+		released += cached.second.profile->ReleaseCaches();
+	}
+	return released;
+}
+
 DistortionProfileConstructor::~DistortionProfileConstructor(){
+	// the jobs refer to this object so they must finish first
+	CancelJobs();
+	if(pendingProfile != nullptr){
+		delete pendingProfile;
+	}
+	for(auto& cached : profileCache){
+		delete cached.second.profile;
+	}
+	for(RetiredProfile& retired : retiredProfiles){
+		delete retired.profile;
+	}
 	if(profile != nullptr && profile != &distortionSettings){
 		delete profile;
 	}
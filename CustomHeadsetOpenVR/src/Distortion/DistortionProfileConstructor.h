@@ -2,6 +2,14 @@
 #include "../Config/ConfigLoader.h"
 #include "DistortionProfile.h"
 #include "NoneDistortionProfile.h"
+#include "../Driver/WorkerPool.h"
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+#include <chrono>
 
 // this class is responsible for loading distortion profiles based on names
 class DistortionProfileConstructor{
@@ -15,8 +23,72 @@ class DistortionProfileConstructor{
 		// load a distortion profile by name
 		// returns true if the profile was changed to indicate the distortion mesh must be refreshed
 		bool LoadDistortionProfile(std::string name);
+		// load a distortion profile from a config that did not come from the config folder
+		// returns true if the profile was changed to indicate the distortion mesh must be refreshed
+		bool LoadDistortionProfile(const DistortionProfileConfig& config);
+		// start loading a distortion profile by name on a worker thread
+		// the finished profile is not used until ApplyPendingProfile is called
+		// force rebuilds the profile even if it has not changed
+		void LoadDistortionProfileAsync(std::string name, WorkerPriority priority = WorkerPriorityNormal, bool force = false);
+		// start building a distortion profile from a config that did not come from disk, such as one from the distortion mailbox
+		// the profile is always rebuilt and is not used until ApplyPendingProfile is called
+		void LoadDistortionProfileAsync(const DistortionProfileConfig& config, WorkerPriority priority = WorkerPriorityNormal);
+		// replace the current profile with one finished by LoadDistortionProfileAsync
+		// returns true if the profile was changed to indicate the distortion mesh must be refreshed
+		bool ApplyPendingProfile();
+		// cache or delete profiles that were replaced long enough ago that the compositor can no longer be evaluating them
+		// call this every frame from the thread that applies profiles
+		void ReleaseRetiredProfiles();
+		// block until a profile started by LoadDistortionProfileAsync has finished building
+		void WaitForPendingProfile();
+		// build profiles ahead of time on the idle lane and keep them so switching to them does not wait for a build
+		// profiles that are no longer in names are dropped from the cache
+		void PrebuildProfiles(const std::vector<std::string>& names);
+		// cancel any pending profile and free the caches of cached profiles
+		// the current and retired profiles keep their caches since they can be in use on other threads
+		// returns the number of bytes freed
+		size_t ReleaseCaches();
 		virtual ~DistortionProfileConstructor();
 	private:
-		std::string profileName;
-		double profileModifiedTime;
+		// config of the current profile, its name and modified time are used to skip rebuilding unchanged profiles
+		DistortionProfileConfig profileConfig;
+		// get the config for a built in profile or load it from disk
+		DistortionProfileConfig GetProfileConfig(std::string name);
+		// construct and initialize a profile from a config, returns nullptr if the type is not supported
+		DistortionProfile* BuildProfile(const DistortionProfileConfig& config);
+		// replace the current profile, newProfile can be nullptr to fall back to distortionSettings
+		bool ReplaceProfile(DistortionProfile* newProfile, const DistortionProfileConfig& config);
+		// build the profile returned by getConfig on a worker and store it as the pending profile
+		void StartProfileJob(WorkerPriority priority, bool force, std::function<DistortionProfileConfig()> getConfig);
+		
+		// profile built by LoadDistortionProfileAsync that is waiting to be applied
+		std::mutex pendingLock;
+		WorkerJobHandle pendingJob = nullptr;
+		std::atomic<bool> pendingReady = false;
+		DistortionProfile* pendingProfile = nullptr;
+		DistortionProfileConfig pendingConfig;
+		
+		// profiles built by PrebuildProfiles by name, a profile is moved out of the cache while it is the current profile
+		// and moved back when it is replaced, so every profile has a single owner
+		struct CachedProfile{
+			DistortionProfile* profile;
+			DistortionProfileConfig config;
+		};
+		std::map<std::string, CachedProfile> profileCache;
+		// profiles replaced as the current profile, the compositor may still be evaluating them until it has rebuilt its mesh
+		struct RetiredProfile{
+			DistortionProfile* profile;
+			DistortionProfileConfig config;
+			std::chrono::steady_clock::time_point retireTime;
+		};
+		std::vector<RetiredProfile> retiredProfiles;
+		// seconds a replaced profile is kept before it is cached or deleted, this covers the compositor regenerating its mesh
+		static constexpr double retiredProfileSeconds = 5.0;
+		// names of profiles that should be kept in the cache
+		std::set<std::string> cachedProfileNames;
+		std::vector<WorkerJobHandle> prebuildJobs;
+		// take a profile matching config out of the cache, returns nullptr if there is none, must be called with pendingLock held
+		DistortionProfile* TakeCachedProfile(const DistortionProfileConfig& config);
+		// cancel and wait for all jobs, must be called without pendingLock held
+		void CancelJobs();
 };
\ No newline at end of file
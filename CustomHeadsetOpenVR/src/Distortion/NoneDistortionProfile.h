@@ -30,4 +30,9 @@ public:
 	virtual Point2D ComputeDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV) override{
 		return {fU, fV};
 	};
+	
+	virtual bool ComputeInverseDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, Point2D& result) override{
+		result = {fU, fV};
+		return true;
+	};
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "PluginDistortionProfile.h"
+#include "../Driver/DriverLog.h"
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+
+PluginDistortionProfile::PluginDistortionProfile(const CustomHeadsetDistortionPlugin* plugin, const DistortionProfileConfig& config) : plugin(plugin), name(config.name), data(config.data), blobPath(config.blobPath){
+}
+
+bool PluginDistortionProfile::IsBuilt(){
+	return built;
+}
+
+void PluginDistortionProfile::Initialize(){
+	if(kernel == nullptr){
+		kernel = plugin->Create();
+		if(kernel == nullptr){
+			DriverLog("Distortion plugin %s could not create a kernel for %s", plugin->name, name.c_str());
+			built = false;
+			return;
+		}
+	}
+	std::vector<char> blob;
+	if(!blobPath.empty()){
+		std::ifstream blobFile(blobPath, std::ios::binary);
+		if(!blobFile.is_open()){
+			DriverLog("Could not open the blob %s of distortion profile %s", blobPath.c_str(), name.c_str());
+			built = false;
+			return;
+		}
+		blob.assign(std::istreambuf_iterator<char>(blobFile), std::istreambuf_iterator<char>());
+	}
+	char error[256] = {};
+	built = plugin->Build(kernel, data.c_str(), data.size(), blob.empty() ? nullptr : blob.data(), blob.size(), resolution, error, sizeof(error)) == 0;
+	if(!built){
+		error[sizeof(error) - 1] = 0;
+		DriverLog("Distortion plugin %s failed to build %s: %s", plugin->name, name.c_str(), error);
+	}
+	// caches the kernel rebuilds on its own after ReleaseCaches are counted on the next build or release
+	trackedMemory.Resize(sizeof(*this) + data.capacity() + GetCacheMemoryUsage());
+}
+
+void PluginDistortionProfile::GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfBottom, float* pfTop){
+	plugin->GetProjectionRaw(kernel, (uint32_t)eEye, pfLeft, pfRight, pfBottom, pfTop);
+}
+
+Point2D PluginDistortionProfile::ComputeDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV){
+	Point2D distortion;
+	plugin->Evaluate(kernel, (uint32_t)eEye, (uint32_t)colorChannel, &fU, &fV, &distortion.x, &distortion.y, 1);
+	return distortion;
+}
+
+void PluginDistortionProfile::ComputeDistortionBatch(vr::EVREye eEye, ColorChannel colorChannel, const float* fU, const float* fV, float* outU, float* outV, uint32_t count){
+	plugin->Evaluate(kernel, (uint32_t)eEye, (uint32_t)colorChannel, fU, fV, outU, outV, count);
+}
+
+bool PluginDistortionProfile::ComputeInverseDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, Point2D& result){
+	if(plugin->EvaluateInverse == nullptr){
+		return false;
+	}
+	plugin->EvaluateInverse(kernel, (uint32_t)eEye, (uint32_t)colorChannel, &fU, &fV, &result.x, &result.y, 1);
+	return true;
+}
+
+size_t PluginDistortionProfile::GetCacheMemoryUsage(){
+	if(plugin->GetCacheMemoryUsage == nullptr){
+		return 0;
+	}
+	return plugin->GetCacheMemoryUsage(kernel);
+}
+
+size_t PluginDistortionProfile::ReleaseCaches(){
+	if(plugin->ReleaseCaches == nullptr){
+		return 0;
+	}
+	size_t released = plugin->ReleaseCaches(kernel);
+	trackedMemory.Resize(sizeof(*this) + data.capacity() + GetCacheMemoryUsage());
+	return released;
+}
+
+PluginDistortionProfile::~PluginDistortionProfile(){
+	if(kernel != nullptr){
+		plugin->Destroy(kernel);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "DistortionProfile.h"
+#include "DistortionPluginApi.h"
+#include "../Config/Config.h"
+
+
+// A distortion profile evaluated by a kernel from a distortion plugin, see DistortionPluginApi.h
+class PluginDistortionProfile : public DistortionProfile{
+public:
+	PluginDistortionProfile(const CustomHeadsetDistortionPlugin* plugin, const DistortionProfileConfig& config);
+	// false if the kernel failed to build, the profile then does no distortion
+	bool IsBuilt();
+	
+	// creates the kernel and builds it from the profile
+	virtual void Initialize() override;
+	
+	virtual void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfBottom, float* pfTop) override;
+	
+	virtual Point2D ComputeDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV) override;
+	
+	virtual void ComputeDistortionBatch(vr::EVREye eEye, ColorChannel colorChannel, const float* fU, const float* fV, float* outU, float* outV, uint32_t count) override;
+	
+	virtual bool ComputeInverseDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, Point2D& result) override;
+	
+	virtual size_t GetCacheMemoryUsage() override;
+	
+	virtual size_t ReleaseCaches() override;
+	
+	virtual ~PluginDistortionProfile();
+private:
+	const CustomHeadsetDistortionPlugin* plugin;
+	CustomHeadsetDistortionKernel* kernel = nullptr;
+	bool built = false;
+	// profile name for logs
+	std::string name;
+	// the whole profile json given to the kernel
+	std::string data;
+	// file given to the kernel as the blob, empty for none
+	std::string blobPath;
+};
@@ -112,8 +112,8 @@ float SampleFromPointsInverse(const std::vector<DistortionPoint>& points, float
 
 
 // sample from float map with linear interpolation
-inline float RadialBezierDistortionProfile::SampleFromMap(float* map, float radius){
-	float indexFloat = radius * radialMapConversion;
+inline float RadialBezierDistortionProfile::SampleFromMap(float* map, float radius, float conversion){
+	float indexFloat = radius * conversion;
 	int index = (int)(indexFloat);
 	if(index < 0){
 		index = 0;
@@ -129,19 +129,32 @@ float RadialBezierDistortionProfile::ComputePPD(std::vector<DistortionPoint> dis
 	return (SampleFromPoints(distortion, degreeEnd) - SampleFromPoints(distortion, degreeStart)) / (degreeEnd - degreeStart) / 100.0f * resolution / 2.0f;
 }
 
-void RadialBezierDistortionProfile::Initialize(){
-	Cleanup();
+void RadialBezierDistortionProfile::BuildCurves(const std::vector<DistortionPoint>& distortions, const std::vector<DistortionPoint>& distortionsRed, const std::vector<DistortionPoint>& distortionsBlue, std::vector<DistortionPoint>& curveRed, std::vector<DistortionPoint>& curveGreen, std::vector<DistortionPoint>& curveBlue){
 	// smooth the points
-	std::vector<DistortionPoint> distortionsSmoothGreen = SmoothPoints(distortions, inBetweenPoints);
+	curveGreen = SmoothPoints(distortions, inBetweenPoints);
 	std::vector<DistortionPoint> distortionsRedPercent = SmoothPoints(distortionsRed, inBetweenPoints);
 	std::vector<DistortionPoint> distortionsBluePercent = SmoothPoints(distortionsBlue, inBetweenPoints);
 	
-	std::vector<DistortionPoint> distortionsSmoothRed = distortionsSmoothGreen;
-	std::vector<DistortionPoint> distortionsSmoothBlue = distortionsSmoothGreen;
+	curveRed = curveGreen;
+	curveBlue = curveGreen;
 	// correct for chromatic aberration
+	for(int i = 0; i < curveGreen.size(); i++){
+		curveRed[i].position *= SampleFromPoints(distortionsRedPercent, curveRed[i].degree) / 100.0f + 1.0f;
+		curveBlue[i].position *= SampleFromPoints(distortionsBluePercent, curveBlue[i].degree) / 100.0f + 1.0f;
+	}
+}
+
+float RadialBezierDistortionProfile::SampleCurve(const std::vector<DistortionPoint>& curve, float degree){
+	return SampleFromPoints(curve, degree);
+}
+
+void RadialBezierDistortionProfile::Initialize(){
+	Cleanup();
+	std::vector<DistortionPoint> distortionsSmoothRed;
+	std::vector<DistortionPoint> distortionsSmoothGreen;
+	std::vector<DistortionPoint> distortionsSmoothBlue;
+	BuildCurves(distortions, distortionsRed, distortionsBlue, distortionsSmoothRed, distortionsSmoothGreen, distortionsSmoothBlue);
 	for(int i = 0; i < distortionsSmoothGreen.size(); i++){
-		distortionsSmoothRed[i].position *= SampleFromPoints(distortionsRedPercent, distortionsSmoothRed[i].degree) / 100.0f + 1.0f;
-		distortionsSmoothBlue[i].position *= SampleFromPoints(distortionsBluePercent, distortionsSmoothBlue[i].degree) / 100.0f + 1.0f;
 		halfFov = std::max(halfFov, distortionsSmoothGreen[i].degree);
 	}
 	
@@ -197,6 +210,18 @@ void RadialBezierDistortionProfile::Initialize(){
 		radialUVMapB[i] = SampleFromPointsInverse(distortionsSmoothBlue, outputRadius);
 	}
 	
+	// create inverse radial maps covering the input image out to the edge of the fov
+	radialInverseMapR = new float[radialMapSize];
+	radialInverseMapG = new float[radialMapSize];
+	radialInverseMapB = new float[radialMapSize];
+	radialInverseMapConversion = (float)radialMapSize / 1.0f;
+	for(int i = 0; i < radialMapSize; i++){
+		float inputRadius = i / radialInverseMapConversion;
+		radialInverseMapR[i] = SampleFromPoints(distortionsSmoothRed, inputRadius) / 100.0f;
+		radialInverseMapG[i] = SampleFromPoints(distortionsSmoothGreen, inputRadius) / 100.0f;
+		radialInverseMapB[i] = SampleFromPoints(distortionsSmoothBlue, inputRadius) / 100.0f;
+	}
+	
 	if(false){
 		char* radialMapLog = new char[radialMapSize * 20];
 		int radialMapLogSize = 0;
@@ -206,7 +231,7 @@ void RadialBezierDistortionProfile::Initialize(){
 		DriverLog("distortion radial map: %s", radialMapLog);
 		delete[] radialMapLog;
 	}
-	
+	trackedMemory.Resize(sizeof(*this) + GetCacheMemoryUsage());
 }
 
 void RadialBezierDistortionProfile::GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfBottom, float* pfTop){
@@ -224,7 +249,6 @@ void RadialBezierDistortionProfile::GetProjectionRaw(vr::EVREye eEye, float* pfL
 }
 
 Point2D RadialBezierDistortionProfile::ComputeDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV){
-	
 	// convert to radius and unit vector
 	float radius = sqrt(fU * fU + fV * fV);
 	float unitU = fU / radius;
@@ -240,13 +264,13 @@ Point2D RadialBezierDistortionProfile::ComputeDistortion(vr::EVREye eEye, ColorC
 	// sample distortion map for the given radius and color channel
 	switch (colorChannel){
 		case ColorChannelRed:
-			radius = SampleFromMap(radialUVMapR, radius);
+			radius = SampleFromMap(radialUVMapR, radius, radialMapConversion);
 			break;
 		case ColorChannelGreen:
-			radius = SampleFromMap(radialUVMapG, radius);
+			radius = SampleFromMap(radialUVMapG, radius, radialMapConversion);
 			break;
 		case ColorChannelBlue:
-			radius = SampleFromMap(radialUVMapB, radius);
+			radius = SampleFromMap(radialUVMapB, radius, radialMapConversion);
 			break;
 	}
 	
@@ -257,6 +281,49 @@ Point2D RadialBezierDistortionProfile::ComputeDistortion(vr::EVREye eEye, ColorC
 	return distortion;
 }
 
+bool RadialBezierDistortionProfile::ComputeInverseDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, Point2D& result){
+	// convert to radius and unit vector
+	float radius = sqrt(fU * fU + fV * fV);
+	float unitU = fU / radius;
+	float unitV = fV / radius;
+	// fix NaNs
+	if(unitU != unitU){
+		unitU = 0;
+	}
+	if(unitV != unitV){
+		unitV = 0;
+	}
+	
+	switch (colorChannel){
+		case ColorChannelRed:
+			radius = SampleFromMap(radialInverseMapR, radius, radialInverseMapConversion);
+			break;
+		case ColorChannelGreen:
+			radius = SampleFromMap(radialInverseMapG, radius, radialInverseMapConversion);
+			break;
+		case ColorChannelBlue:
+			radius = SampleFromMap(radialInverseMapB, radius, radialInverseMapConversion);
+			break;
+	}
+	
+	result.x = unitU * radius;
+	result.y = unitV * radius;
+	return true;
+}
+
+size_t RadialBezierDistortionProfile::GetCacheMemoryUsage(){
+	if(radialUVMapG == nullptr){
+		return 0;
+	}
+	return 6 * radialMapSize * sizeof(float);
+}
+
+size_t RadialBezierDistortionProfile::ReleaseCaches(){
+	size_t released = GetCacheMemoryUsage();
+	Cleanup();
+	return released;
+}
+
 void RadialBezierDistortionProfile::Cleanup(){
 	if(radialUVMapR != nullptr){
 		delete[] radialUVMapR;
@@ -270,6 +337,19 @@ void RadialBezierDistortionProfile::Cleanup(){
 		delete[] radialUVMapB;
 		radialUVMapB = nullptr;
 	}
+	if(radialInverseMapR != nullptr){
+		delete[] radialInverseMapR;
+		radialInverseMapR = nullptr;
+	}
+	if(radialInverseMapG != nullptr){
+		delete[] radialInverseMapG;
+		radialInverseMapG = nullptr;
+	}
+	if(radialInverseMapB != nullptr){
+		delete[] radialInverseMapB;
+		radialInverseMapB = nullptr;
+	}
+	trackedMemory.Resize(sizeof(*this));
 }
 
 RadialBezierDistortionProfile::~RadialBezierDistortionProfile(){
@@ -24,6 +24,15 @@ public:
 	// additional percent distortions for the blue channel to be done after the main distortion
 	std::vector<DistortionPoint> distortionsBlue ={{0, -0.42}, {47.5, -0.42}};
 	
+	// points added between each pair of distortion points when smoothing
+	static const int inBetweenPoints = 20;
+	// build the smoothed curve of each channel from degrees in the input image to percent on the display
+	// this is the curve model of the profile, the maps are built from these curves
+	// every curve position is linear in the positions of distortions, and in the red or blue percentages for fixed distortions
+	static void BuildCurves(const std::vector<DistortionPoint>& distortions, const std::vector<DistortionPoint>& distortionsRed, const std::vector<DistortionPoint>& distortionsBlue, std::vector<DistortionPoint>& curveRed, std::vector<DistortionPoint>& curveGreen, std::vector<DistortionPoint>& curveBlue);
+	// percent on the display at a degree on a curve from BuildCurves
+	static float SampleCurve(const std::vector<DistortionPoint>& curve, float degree);
+	
 private:
 	// this is automatically calculated from the distortions
 	// this is the fov that is given by circle at radius 1
@@ -33,11 +42,16 @@ private:
 	float* radialUVMapR = nullptr;
 	float* radialUVMapG = nullptr;
 	float* radialUVMapB = nullptr;
+	// the inverse of the radial maps, the index is the input image and the values are the output
+	float* radialInverseMapR = nullptr;
+	float* radialInverseMapG = nullptr;
+	float* radialInverseMapB = nullptr;
 	// conversion from radius in output to to an index in the maps
 	float radialMapConversion = 0;
+	// conversion from radius in input to an index in the inverse maps
+	float radialInverseMapConversion = 0;
 	int radialMapSize = 512;
-	int inBetweenPoints = 20;
-	inline float SampleFromMap(float* map, float radius);
+	inline float SampleFromMap(float* map, float radius, float conversion);
 	float ComputePPD(std::vector<DistortionPoint> distortion, float degreeStart, float degreeEnd);
 	void Cleanup();
 public:
@@ -47,5 +61,11 @@ public:
 	
 	virtual Point2D ComputeDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV) override;
 	
+	virtual bool ComputeInverseDistortion(vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, Point2D& result) override;
+	
+	virtual size_t GetCacheMemoryUsage() override;
+	
+	virtual size_t ReleaseCaches() override;
+	
 	virtual ~RadialBezierDistortionProfile();
 };
\ No newline at end of file
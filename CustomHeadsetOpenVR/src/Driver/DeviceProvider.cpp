@@ -1,6 +1,10 @@
 #include "DeviceProvider.h"
 #include "DriverLog.h"
 #include "DeviceShim.h"
+#include "WorkerPool.h"
+#include "StartupTimeline.h"
+#include "FlightRecorder.h"
+#include "../Distortion/DistortionPluginLoader.h"
 
 #include "Hooking/InterfaceHookInjector.h"
 
@@ -8,14 +12,78 @@
 
 #include "../Config/ConfigLoader.h"
 
+#include "Windows.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+
+// lower case executable file name of a process, empty if it can't be found
+static std::string GetProcessExecutableName(uint32_t pid){
+	if(pid == 0){
+		return "";
+	}
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+	if(process == NULL){
+		return "";
+	}
+	char path[MAX_PATH] = {};
+	DWORD pathLength = MAX_PATH;
+	std::string name = "";
+	if(QueryFullProcessImageNameA(process, 0, path, &pathLength)){
+		name = path;
+		size_t separator = name.find_last_of("\\/");
+		if(separator != std::string::npos){
+			name = name.substr(separator + 1);
+		}
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){ return (char)std::tolower(c); });
+	}
+	CloseHandle(process);
+	return name;
+}
+
 
 // general driver functions
 vr::EVRInitError CustomHeadsetDeviceProvider::Init(vr::IVRDriverContext *pDriverContext){
+	driverStartupTimeline.Mark("Init");
 	// initialise this driver
 	VR_INIT_SERVER_DRIVER_CONTEXT(pDriverContext);
 	driverConfigLoader.Start();
+	driverStartupTimeline.Mark("ConfigLoaded");
+	if(driverConfig.enableFlightRecorder){
+		std::error_code error;
+		std::filesystem::create_directories(driverConfigLoader.GetConfigFolder(), error);
+		driverFlightRecorder.Open(driverConfigLoader.GetConfigFolder() + "FlightRecorder.bin");
+	}
+	// distortion plugins have to be loaded before any profile is built
+	driverDistortionPlugins.LoadPlugins(driverConfigLoader.GetConfigFolder() + "Plugins/");
+	driverStartupTimeline.Mark("PluginsLoaded");
+	// start background workers for profile builds and file parsing
+	driverWorkerPool.Start(driverConfig.workerThreads, driverConfig.workerAvoidCores);
+	// directory setup and watching for changes happens in the background
+	driverConfigLoader.StartWatchers();
 	// inject hooks into functions
 	InjectHooks(this, pDriverContext);
+	driverStartupTimeline.Mark("HooksInjected");
+	// pause background activity while in standby
+	standbyManager.Register("TaskScheduler timers", [this](){
+		scheduler.SetTimersPaused(true);
+		return (size_t)0;
+	}, [this](){
+		scheduler.SetTimersPaused(false);
+	});
+	standbyManager.Register("ConfigLoader watchers", [](){
+		driverConfigLoader.PauseWatchers();
+		return (size_t)0;
+	}, [](){
+		driverConfigLoader.ResumeWatchers();
+	});
+	// periodically log how long scheduled work is taking
+	scheduler.RunEvery("CustomHeadsetDeviceProvider::LogStatistics", 60.0, [this](){
+		scheduler.LogStatistics();
+		driverWorkerPool.LogStatistics();
+		driverMemory.LogStatistics();
+	});
 	return vr::VRInitError_None;
 }
 const char *const *CustomHeadsetDeviceProvider::GetInterfaceVersions(){
@@ -24,9 +92,36 @@ const char *const *CustomHeadsetDeviceProvider::GetInterfaceVersions(){
 bool CustomHeadsetDeviceProvider::ShouldBlockStandbyMode(){
 	return false;
 }
-void CustomHeadsetDeviceProvider::Cleanup(){}
-void CustomHeadsetDeviceProvider::EnterStandby(){}
-void CustomHeadsetDeviceProvider::LeaveStandby(){}
+void CustomHeadsetDeviceProvider::Cleanup(){
+	scheduler.Stop();
+	driverConfigLoader.Stop();
+	// wait for background work last since the other systems can still submit jobs while stopping
+	driverWorkerPool.Stop();
+	// events still queued will never find their context now
+	queuedEvents.clear();
+	driverContexts.clear();
+	driverContextsByDeviceId.clear();
+	UpdateContextMemory();
+	UpdateQueuedEventMemory();
+	driverMemory.LogStatistics();
+	// SteamVR never gives back the drivers and components it was given, so each shim keeps its wrapped driver
+	// and the display component of its activated device, any other shim objects are components that were created again
+	int64_t expectedShimObjects = 0;
+	for(ShimDefinition* shim : shims){
+		expectedShimObjects += shim->displayComponent != nullptr ? 2 : 1;
+	}
+	// the global config, the profiles of the shims and the installed hooks live until the process exits so they are not checked
+	driverMemory.CheckLeaks({{MemorySubsystemEvents, 0}, {MemorySubsystemShim, expectedShimObjects}});
+	// nothing records after this point
+	driverFlightRecorder.Record(FlightRecorderCleanup);
+	driverFlightRecorder.Close();
+}
+void CustomHeadsetDeviceProvider::EnterStandby(){
+	standbyManager.EnterStandby();
+}
+void CustomHeadsetDeviceProvider::LeaveStandby(){
+	standbyManager.LeaveStandby();
+}
 
 
 void CustomHeadsetDeviceProvider::RunFrame(){
@@ -52,16 +147,25 @@ void CustomHeadsetDeviceProvider::RunFrame(){
 					}
 					queuedEvents.erase(id);
 				}
+				UpdateQueuedEventMemory();
+			}
+		}else if(vrevent.eventType == vr::VREvent_SceneApplicationChanged){
+			std::string application = GetProcessExecutableName(vrevent.data.process.pid);
+			if(application != sceneApplication){
+				DriverLog("Scene application changed to %s", application.empty() ? "none" : application.c_str());
+				driverFlightRecorder.Record(FlightRecorderSceneApplicationChanged, application.c_str());
+				sceneApplication = application;
+				// only the overrides depend on the application so the rest of the config is not applied again
+				for(ShimDefinition* shim : shims){
+					if(shim->shimActive){
+						shim->SceneApplicationChanged();
+					}
+				}
 			}
 		}
 	}
-	for(auto shim : shims){
-		if(shim->shimActive){
-			shim->RunFrame();
-		}
-	}
-	// clear update flag at end of frame
-	driverConfig.hasBeenUpdated = false;
+	// run shims and other scheduled work within the frame budget
+	scheduler.RunFrame();
 }
 
 void CustomHeadsetDeviceProvider::SendContextCollectionEvents(uint32_t id){
@@ -80,6 +184,7 @@ bool CustomHeadsetDeviceProvider::SendVendorEvent(uint32_t unWhichDevice, vr::EV
 		vr::EVRInitError eError = vr::VRInitError_None;
 		vr::IVRServerDriverHost* VRServerDriverHost =  (vr::IVRServerDriverHost *)driverContextsByDeviceId[unWhichDevice]->GetGenericInterface(vr::IVRServerDriverHost_Version, &eError);
 		VRServerDriverHost->VendorSpecificEvent(unWhichDevice, eventType, eventData, eventTimeOffset);
+		driverFlightRecorder.Record(FlightRecorderVendorEvent, "sent", eventType, unWhichDevice);
 		return true;
 	}else{
 		// try to find context and queue for later
@@ -88,14 +193,35 @@ bool CustomHeadsetDeviceProvider::SendVendorEvent(uint32_t unWhichDevice, vr::EV
 			queuedEvents[unWhichDevice] = {};
 		}
 		queuedEvents[unWhichDevice].push_back({eventType, eventData, eventTimeOffset});
+		UpdateQueuedEventMemory();
+		driverFlightRecorder.Record(FlightRecorderVendorEvent, "queued", eventType, unWhichDevice);
 		return false;
 	}
 }
 
 
+void CustomHeadsetDeviceProvider::UpdateContextMemory(){
+	size_t contexts = driverContexts.size();
+	contextMemory.Resize(contexts * (memoryTreeNodeOverhead + sizeof(vr::IVRDriverContext*)), contexts);
+}
+
+void CustomHeadsetDeviceProvider::UpdateQueuedEventMemory(){
+	size_t deviceContexts = driverContextsByDeviceId.size();
+	deviceContextMemory.Resize(deviceContexts * (memoryTreeNodeOverhead + sizeof(std::pair<uint32_t, vr::IVRDriverContext*>)), deviceContexts);
+	size_t events = 0;
+	size_t eventBytes = 0;
+	for(auto& deviceEvents : queuedEvents){
+		events += deviceEvents.second.size();
+		eventBytes += memoryTreeNodeOverhead + sizeof(deviceEvents) + deviceEvents.second.capacity() * sizeof(QueuedEvent);
+	}
+	queuedEventMemory.Resize(eventBytes, events);
+}
+
+
 bool CustomHeadsetDeviceProvider::HandleDeviceAdded(const char *&pchDeviceSerialNumber, vr::ETrackedDeviceClass &eDeviceClass, vr::ITrackedDeviceServerDriver *&pDriver){
 	DriverLog("HandleDeviceAdded %s\n", pchDeviceSerialNumber);
 	if(eDeviceClass == vr::TrackedDeviceClass_HMD){
+		driverStartupTimeline.Mark("HmdDeviceAdded");
 		
 		// add more shims here, they can stack and none of the functions are particularly hot
 		// later shims can override earlier shims
@@ -105,6 +231,18 @@ bool CustomHeadsetDeviceProvider::HandleDeviceAdded(const char *&pchDeviceSerial
 			MeganeX8KShim* meganeX8KShim = new MeganeX8KShim();
 			meganeX8KShim->deviceProvider = this;
 			shims.insert(meganeX8KShim);
+			scheduler.AddFrameHook("MeganeX8KShim::RunFrame", 500, [meganeX8KShim](){
+				if(meganeX8KShim->shimActive){
+					meganeX8KShim->RunFrame();
+				}
+			});
+			standbyManager.Register("MeganeX8KShim", [meganeX8KShim](){
+				return meganeX8KShim->shimActive ? meganeX8KShim->EnterStandby() : 0;
+			}, [meganeX8KShim](){
+				if(meganeX8KShim->shimActive){
+					meganeX8KShim->LeaveStandby();
+				}
+			});
 			pDriver = new ShimTrackedDeviceDriver(meganeX8KShim, pDriver);
 		}
 	}
@@ -3,8 +3,12 @@
 #include <set>
 #include <map>
 #include <vector>
+#include <string>
 
 #include "openvr_driver.h"
+#include "TaskScheduler.h"
+#include "StandbyManager.h"
+#include "MemoryAccounting.h"
 
 class ShimDefinition;
 
@@ -37,6 +41,10 @@ public:
 	// map of driver contexts by device id
 	// this is populated by VREvent_VendorSpecific_ContextCollection events
 	std::map<uint32_t, vr::IVRDriverContext*> driverContextsByDeviceId = {};
+	// count driverContexts after it changes, this only reads its size so the GetGenericInterface detour can call it
+	void UpdateContextMemory();
+	// count driverContextsByDeviceId and the queued events after they change, only call this from the main loop
+	void UpdateQueuedEventMemory();
 	// sends out VREvent_VendorSpecific_ContextCollection events for a given device id
 	// after some time, the driverContextsByDeviceId map should be contain the context for this device
 	void SendContextCollectionEvents(uint32_t id);
@@ -45,8 +53,15 @@ public:
 	// events must be sent from the context that owns the device, so this is necessary
 	bool SendVendorEvent(uint32_t unWhichDevice, vr::EVREventType eventType, const vr::VREvent_Data_t & eventData, double eventTimeOffset);
 	// a set of all shim objects to manage
-	// this allows them to have RunThread called
+	// this allows them to have RunFrame called
 	std::set<ShimDefinition*> shims;
+	// runs frame hooks, timers and background jobs for the driver and its shims
+	TaskScheduler scheduler;
+	// releases resources while in standby and restores them afterwards
+	StandbyManager standbyManager;
+	// lower case executable name of the current scene application, empty if there is none
+	// used to pick the overrides in appOverrides
+	std::string sceneApplication = "";
 private:
 	struct QueuedEvent {
 		vr::EVREventType eventType;
@@ -55,4 +70,8 @@ private:
 	};
 	// events that are waiting for a context to be found
 	std::map<uint32_t, std::vector<QueuedEvent>> queuedEvents = {}; 
+	// contextMemory is resized from the detour and the others from the main loop, so the detour never walks the queued events
+	TrackedMemory contextMemory{MemorySubsystemHooking, 0, 0};
+	TrackedMemory deviceContextMemory{MemorySubsystemHooking, 0, 0};
+	TrackedMemory queuedEventMemory{MemorySubsystemEvents, 0, 0};
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "openvr_driver.h"
+#include "MemoryAccounting.h"
 #include <atomic>
 #include <thread>
 
@@ -59,12 +60,21 @@ public:
 	
 	// run on every frame of the main loop of the server
 	virtual void RunFrame(){};
+	// SteamVR is entering standby, free anything that is not needed while the headset sleeps
+	// returns the number of bytes freed
+	virtual size_t EnterStandby(){return 0;};
+	// SteamVR is leaving standby, start rebuilding anything that will be needed right away
+	virtual void LeaveStandby(){};
+	// the scene application has changed, CustomHeadsetDeviceProvider::sceneApplication holds the new one
+	virtual void SceneApplicationChanged(){};
 };
 
 class ShimTrackedDeviceDriver : public vr::ITrackedDeviceServerDriver{
 public:
 	ShimTrackedDeviceDriver(ShimDefinition* shimDefinition, vr::ITrackedDeviceServerDriver* original);
 	ShimDefinition* shimDefinition;
+	// SteamVR never gives these back so they stay counted until the driver is unloaded
+	TrackedMemory trackedMemory{MemorySubsystemShim, sizeof(ShimTrackedDeviceDriver)};
 	
 	vr::EVRInitError Activate( uint32_t unObjectId ) override;
 	void EnterStandby() override;
@@ -78,6 +88,8 @@ class ShimDisplayComponent : public vr::IVRDisplayComponent{
 public:
 	explicit ShimDisplayComponent(ShimDefinition* shimDefinition, vr::IVRDisplayComponent *original);
 	ShimDefinition* shimDefinition;
+	// a new one is made each time the component is requested, a growing count shows they are being requested repeatedly
+	TrackedMemory trackedMemory{MemorySubsystemShim, sizeof(ShimDisplayComponent)};
 	
 	bool IsDisplayOnDesktop() override;
 	bool IsDisplayRealDisplay() override;
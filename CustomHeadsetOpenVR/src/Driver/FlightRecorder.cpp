@@ -0,0 +1,107 @@
+#include "FlightRecorder.h"
+#include "DriverLog.h"
+#include "Windows.h"
+#include <chrono>
+#include <thread>
+#include <cstring>
+
+
+FlightRecorder driverFlightRecorder;
+
+static int64_t NowUnixMicroseconds(){
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool FlightRecorder::Open(const std::string& path){
+	if(header != nullptr){
+		return true;
+	}
+	// keep the events of the last session, they are what is needed after a crash
+	std::string previousPath = path + ".previous";
+	MoveFileExA(path.c_str(), previousPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+	
+	size_t size = sizeof(FlightRecorderHeader) + sizeof(FlightRecorderRecord) * (size_t)flightRecorderRecordCount;
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(fileHandle == INVALID_HANDLE_VALUE){
+		DriverLog("Failed to create flight recorder file %s: %d", path.c_str(), (int)GetLastError());
+		return false;
+	}
+	// mapping a new file at a size extends it with zeros
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+	if(mappingHandle == NULL){
+		DriverLog("Failed to map flight recorder file: %d", (int)GetLastError());
+		CloseHandle(fileHandle);
+		return false;
+	}
+	void* view = MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if(view == NULL){
+		DriverLog("Failed to map flight recorder file: %d", (int)GetLastError());
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+	file = fileHandle;
+	mapping = mappingHandle;
+	FlightRecorderHeader* newHeader = (FlightRecorderHeader*)view;
+	newHeader->version = flightRecorderVersion;
+	newHeader->recordSize = sizeof(FlightRecorderRecord);
+	newHeader->recordCount = flightRecorderRecordCount;
+	newHeader->startTime = NowUnixMicroseconds();
+	newHeader->processId = GetCurrentProcessId();
+	newHeader->magic = flightRecorderMagic;
+	header = newHeader;
+	DriverLog("Flight recorder is writing to %s", path.c_str());
+	Record(FlightRecorderStart);
+	return true;
+}
+
+void FlightRecorder::Close(){
+	FlightRecorderHeader* oldHeader = header.exchange(nullptr);
+	if(oldHeader != nullptr){
+		// new writers see no header from here on, wait for the ones that saw the old one to finish their record
+		while(writers.load() != 0){
+			std::this_thread::yield();
+		}
+		// the pages are written by the system even without this, flushing makes a clean shutdown complete right away
+		FlushViewOfFile(oldHeader, 0);
+		UnmapViewOfFile(oldHeader);
+	}
+	if(mapping != nullptr){
+		CloseHandle((HANDLE)mapping);
+		mapping = nullptr;
+	}
+	if(file != nullptr){
+		CloseHandle((HANDLE)file);
+		file = nullptr;
+	}
+}
+
+void FlightRecorder::Record(FlightRecorderEventType type, const char* text, int64_t value0, int64_t value1){
+	// the writer count is raised before the header is read so Close either sees this writer or this writer sees no header
+	writers.fetch_add(1);
+	FlightRecorderHeader* currentHeader = header.load();
+	if(currentHeader == nullptr){
+		writers.fetch_sub(1);
+		return;
+	}
+	FlightRecorderRecord* records = (FlightRecorderRecord*)(currentHeader + 1);
+	uint64_t sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+	FlightRecorderRecord& record = records[(sequence - 1) & (flightRecorderRecordCount - 1)];
+	record.sequence = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	record.time = NowUnixMicroseconds();
+	record.threadId = GetCurrentThreadId();
+	record.type = type;
+	record.reserved = 0;
+	record.value0 = value0;
+	record.value1 = value1;
+	if(text != nullptr){
+		strncpy(record.text, text, sizeof(record.text) - 1);
+		record.text[sizeof(record.text) - 1] = 0;
+	}else{
+		record.text[0] = 0;
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+	record.sequence = sequence;
+	writers.fetch_sub(1, std::memory_order_release);
+}
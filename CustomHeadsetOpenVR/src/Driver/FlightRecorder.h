@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+
+// Layout of the flight recorder file, a header followed by a ring of fixed size records.
+// Writers claim a sequence number, clear the sequence of the record, write it and then store the sequence last,
+// so a record is complete if its sequence is not 0 and belongs to its slot, even if the process crashed while writing.
+// The decoder sorts the complete records by sequence, see the flight-recorder command of CustomHeadsetTools.
+#pragma pack(push, 8)
+struct FlightRecorderRecord{
+	// sequence number starting at 1, 0 while the record is being written
+	volatile uint64_t sequence;
+	// microseconds since the unix epoch
+	int64_t time;
+	uint32_t threadId;
+	// FlightRecorderEventType
+	uint16_t type;
+	uint16_t reserved;
+	// meaning depends on the type
+	int64_t value0;
+	int64_t value1;
+	// name of what the event is about, truncated and always null terminated
+	char text[88];
+};
+struct FlightRecorderHeader{
+	// 'CHFR'
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t recordCount;
+	// time the recorder was opened in microseconds since the unix epoch
+	int64_t startTime;
+	uint32_t processId;
+	uint32_t reserved[9];
+};
+#pragma pack(pop)
+static const uint32_t flightRecorderMagic = 0x52464843;
+static const uint32_t flightRecorderVersion = 1;
+// must be a power of 2
+static const uint32_t flightRecorderRecordCount = 32768;
+
+enum FlightRecorderEventType : uint16_t{
+	FlightRecorderStart = 1,
+	// value0 is 1 if the config was parsed
+	FlightRecorderConfigReload,
+	// text is the profile name
+	FlightRecorderProfileBuildStart,
+	// text is the profile name, value0 is the build time in microseconds
+	FlightRecorderProfileBuildEnd,
+	// value0 is the event type, value1 is the device, text is sent or queued
+	FlightRecorderVendorEvent,
+	// text is the hook name, value0 is 1 if it was enabled
+	FlightRecorderHookInstall,
+	// text is the task name, value0 is the duration and value1 the budget in microseconds
+	FlightRecorderTaskOverrun,
+	// value0 is the number of deferred frame hooks and value1 the number of deferred timers
+	FlightRecorderFrameDeferral,
+	// text is the device, value0 is the object id and value1 the result of activation
+	FlightRecorderDeviceActivate,
+	FlightRecorderDeviceDeactivate,
+	FlightRecorderStandbyEnter,
+	FlightRecorderStandbyLeave,
+	// text is the executable name
+	FlightRecorderSceneApplicationChanged,
+	FlightRecorderCleanup,
+};
+
+inline const char* FlightRecorderEventName(uint16_t type){
+	switch(type){
+		case FlightRecorderStart: return "Start";
+		case FlightRecorderConfigReload: return "ConfigReload";
+		case FlightRecorderProfileBuildStart: return "ProfileBuildStart";
+		case FlightRecorderProfileBuildEnd: return "ProfileBuildEnd";
+		case FlightRecorderVendorEvent: return "VendorEvent";
+		case FlightRecorderHookInstall: return "HookInstall";
+		case FlightRecorderTaskOverrun: return "TaskOverrun";
+		case FlightRecorderFrameDeferral: return "FrameDeferral";
+		case FlightRecorderDeviceActivate: return "DeviceActivate";
+		case FlightRecorderDeviceDeactivate: return "DeviceDeactivate";
+		case FlightRecorderStandbyEnter: return "StandbyEnter";
+		case FlightRecorderStandbyLeave: return "StandbyLeave";
+		case FlightRecorderSceneApplicationChanged: return "SceneApplicationChanged";
+		case FlightRecorderCleanup: return "Cleanup";
+	}
+	return "Unknown";
+}
+
+
+// Keeps the most recent driver events in a memory mapped file so they survive a crash of vrserver.
+// Recording is lock free and costs a few atomic increments and a copy of one record, so it is always enabled.
+// The file of the previous session is kept next to it with .previous added to the name.
+class FlightRecorder{
+public:
+	// create the file and map it, returns false if recording is not possible
+	bool Open(const std::string& path);
+	// stop recording and unmap the file, this waits for threads that are still writing a record
+	void Close();
+	// record an event from any thread, does nothing if the recorder is not open
+	void Record(FlightRecorderEventType type, const char* text = nullptr, int64_t value0 = 0, int64_t value1 = 0);
+private:
+	std::atomic<FlightRecorderHeader*> header = nullptr;
+	std::atomic<uint64_t> nextSequence = 1;
+	// threads inside Record, Close does not unmap the file until this is 0
+	std::atomic<uint32_t> writers = 0;
+	void* file = nullptr;
+	void* mapping = nullptr;
+};
+
+// global flight recorder
+extern FlightRecorder driverFlightRecorder;
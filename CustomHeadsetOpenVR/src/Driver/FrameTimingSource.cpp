@@ -0,0 +1,78 @@
+#include "FrameTimingSource.h"
+#include "DriverLog.h"
+#include "openvr_driver.h"
+#include <sstream>
+
+
+size_t CompositorFrameTimingSource::Poll(std::vector<FrameTimingSample>& samples){
+	// the compositor keeps a short history, this covers the polling interval at high refresh rates
+	const uint32_t frameCount = 32;
+	vr::Compositor_FrameTiming timings[frameCount] = {};
+	for(uint32_t i = 0; i < frameCount; i++){
+		timings[i].m_nSize = sizeof(vr::Compositor_FrameTiming);
+	}
+	if(!vr::VRServerDriverHost()->GetFrameTimings(timings, frameCount)){
+		return 0;
+	}
+	// the most recent frame is last, start over if the compositor restarted its frame count
+	if(timings[frameCount - 1].m_nFrameIndex < lastFrameIndex){
+		lastFrameIndex = 0;
+	}
+	size_t added = 0;
+	for(uint32_t i = 0; i < frameCount; i++){
+		vr::Compositor_FrameTiming& timing = timings[i];
+		if(timing.m_nFrameIndex == 0 || timing.m_nFrameIndex <= lastFrameIndex){
+			continue;
+		}
+		lastFrameIndex = timing.m_nFrameIndex;
+		FrameTimingSample sample;
+		sample.frameIndex = timing.m_nFrameIndex;
+		sample.applicationGpuMs = timing.m_flPreSubmitGpuMs + timing.m_flPostSubmitGpuMs;
+		sample.missed = timing.m_nNumDroppedFrames > 0 || timing.m_nReprojectionFlags != 0;
+		samples.push_back(sample);
+		added++;
+	}
+	return added;
+}
+
+
+FileFrameTimingSource::FileFrameTimingSource(const std::string& path) : path(path){
+	file.open(path);
+	if(!file.is_open()){
+		DriverLog("Could not open frame timing file %s", path.c_str());
+	}
+}
+
+size_t FileFrameTimingSource::Poll(std::vector<FrameTimingSample>& samples){
+	if(!file.is_open()){
+		return 0;
+	}
+	size_t added = 0;
+	std::string line;
+	while(std::getline(file, line)){
+		if(file.eof()){
+			// the writer has not finished this line yet, keep it for the next poll
+			partialLine += line;
+			break;
+		}
+		line = partialLine + line;
+		partialLine.clear();
+		if(line.empty() || line[0] == '#'){
+			continue;
+		}
+		FrameTimingSample sample;
+		int missed = 0;
+		std::istringstream values(line);
+		if(!(values >> sample.applicationGpuMs)){
+			continue;
+		}
+		values >> missed;
+		sample.missed = missed != 0;
+		sample.frameIndex = ++frameIndex;
+		samples.push_back(sample);
+		added++;
+	}
+	// clear eof so lines appended later can be read
+	file.clear();
+	return added;
+}
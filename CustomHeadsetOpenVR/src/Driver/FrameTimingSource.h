@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+
+// timing of a single frame of the scene application
+struct FrameTimingSample{
+	// index of the frame, used to skip frames that have already been seen
+	uint32_t frameIndex = 0;
+	// gpu time the application spent rendering the frame
+	double applicationGpuMs = 0;
+	// true if the compositor had to reproject or drop the frame
+	bool missed = false;
+};
+
+// Provides frame timings to the RenderTargetController.
+// Poll is called periodically and appends the frames that finished since the last call.
+class FrameTimingSource{
+public:
+	virtual ~FrameTimingSource(){};
+	// append new samples, returns the number of samples added
+	virtual size_t Poll(std::vector<FrameTimingSample>& samples) = 0;
+};
+
+// frame timings reported by the compositor through the server driver host
+class CompositorFrameTimingSource : public FrameTimingSource{
+public:
+	virtual size_t Poll(std::vector<FrameTimingSample>& samples) override;
+private:
+	uint32_t lastFrameIndex = 0;
+};
+
+// Reads frame timings from a text file that another process appends to, for testing without an application running.
+// Each line is the application gpu time in milliseconds, optionally followed by 1 if the frame was missed.
+// Lines starting with # are ignored.
+class FileFrameTimingSource : public FrameTimingSource{
+public:
+	FileFrameTimingSource(const std::string& path);
+	virtual size_t Poll(std::vector<FrameTimingSample>& samples) override;
+private:
+	std::string path;
+	std::ifstream file;
+	// text of a line that has not been completed yet
+	std::string partialLine;
+	uint32_t frameIndex = 0;
+};
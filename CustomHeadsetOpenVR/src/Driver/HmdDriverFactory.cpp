@@ -1,4 +1,5 @@
 #include "DeviceProvider.h"
+#include "StartupTimeline.h"
 #include "openvr_driver.h"
 
 
@@ -19,6 +20,7 @@ HMD_DLL_EXPORT void *HmdDriverFactory(const char *pInterfaceName, int *pReturnCo
 	
 	// return CustomHeadsetDeviceProvider
 	if (0 == strcmp(vr::IServerTrackedDeviceProvider_Version, pInterfaceName)){
+		driverStartupTimeline.Mark("HmdDriverFactory");
 		return &deviceProvider;
 	}
 	// Otherwise tell the runtime that we don't have this interface.
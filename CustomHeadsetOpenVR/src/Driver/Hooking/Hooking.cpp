@@ -1,6 +1,18 @@
 #include "Hooking.h"
 
 std::map<std::string, IHook *> IHook::hooks;
+static TrackedMemory hooksMemory(MemorySubsystemHooking, 0, 0);
+
+// count the registered hooks and their map nodes
+static void UpdateHooksMemory(const std::map<std::string, IHook *> &hooks)
+{
+	size_t bytes = 0;
+	for (auto &hook : hooks)
+	{
+		bytes += memoryTreeNodeOverhead + sizeof(hook) + hook.first.capacity();
+	}
+	hooksMemory.Resize(bytes, hooks.size());
+}
 
 bool IHook::Exists(const std::string &name)
 {
@@ -10,11 +22,13 @@ bool IHook::Exists(const std::string &name)
 void IHook::Register(IHook *hook)
 {
 	hooks[hook->name] = hook;
+	UpdateHooksMemory(hooks);
 }
 
 void IHook::Unregister(IHook *hook)
 {
 	hooks.erase(hook->name);
+	UpdateHooksMemory(hooks);
 }
 
 void IHook::DestroyAll()
@@ -24,4 +38,5 @@ void IHook::DestroyAll()
 		hook.second->Destroy();
 	}
 	hooks.clear();
+	UpdateHooksMemory(hooks);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../DriverLog.h"
+#include "../FlightRecorder.h"
+#include "../MemoryAccounting.h"
 
 #include "../../../../ThirdParty/minhook/include/MinHook.h"
 #include <map>
@@ -46,6 +48,7 @@ public:
 		if (err != MH_OK)
 		{
 			DriverLog("Failed to create hook for %s, error: %s", name.c_str(), MH_StatusToString(err));
+			driverFlightRecorder.Record(FlightRecorderHookInstall, name.c_str(), 0);
 			return false;
 		}
 
@@ -54,10 +57,12 @@ public:
 		{
 			DriverLog("Failed to enable hook for %s, error: %s", name.c_str(), MH_StatusToString(err));
 			MH_RemoveHook(targetFunc);
+			driverFlightRecorder.Record(FlightRecorderHookInstall, name.c_str(), 0);
 			return false;
 		}
 
 		DriverLog("Enabled hook for %s", name.c_str());
+		driverFlightRecorder.Record(FlightRecorderHookInstall, name.c_str(), 1);
 		enabled = true;
 		return true;
 	}
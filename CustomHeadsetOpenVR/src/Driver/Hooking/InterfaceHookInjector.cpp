@@ -47,7 +47,11 @@ static void DetourTrackedDeviceAdded006(vr::IVRServerDriverHost *_this, const ch
 
 static void *DetourGetGenericInterface(vr::IVRDriverContext *_this, const char *pchInterfaceVersion, vr::EVRInitError *peError)
 {
-	Driver->driverContexts.insert(_this);  // Store the driver context for later use
+	// Store the driver context for later use
+	if (Driver->driverContexts.insert(_this).second)
+	{
+		Driver->UpdateContextMemory();
+	}
 	
 	// TRACE("ServerTrackedDeviceProvider::DetourGetGenericInterface(%s)", pchInterfaceVersion);
 	auto originalInterface = GetGenericInterfaceHook.originalFunc(_this, pchInterfaceVersion, peError);
@@ -0,0 +1,94 @@
+#include "MemoryAccounting.h"
+#include "DriverLog.h"
+#include <algorithm>
+
+
+MemoryAccounting driverMemory;
+
+static void UpdatePeak(std::atomic<int64_t>& peak, int64_t value){
+	int64_t current = peak.load(std::memory_order_relaxed);
+	while(value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)){
+	}
+}
+
+void MemoryAccounting::Add(MemorySubsystem subsystem, int64_t bytes, int64_t objects){
+	Counters& counter = counters[subsystem];
+	int64_t newBytes = counter.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	int64_t newObjects = counter.objects.fetch_add(objects, std::memory_order_relaxed) + objects;
+	UpdatePeak(counter.peakBytes, newBytes);
+	UpdatePeak(counter.peakObjects, newObjects);
+}
+
+MemoryAccounting::Usage MemoryAccounting::GetUsage(MemorySubsystem subsystem){
+	Counters& counter = counters[subsystem];
+	Usage usage;
+	usage.bytes = counter.bytes.load(std::memory_order_relaxed);
+	usage.peakBytes = counter.peakBytes.load(std::memory_order_relaxed);
+	usage.objects = counter.objects.load(std::memory_order_relaxed);
+	usage.peakObjects = counter.peakObjects.load(std::memory_order_relaxed);
+	return usage;
+}
+
+void MemoryAccounting::LogStatistics(){
+	int64_t totalBytes = 0;
+	for(int i = 0; i < MemorySubsystemCount; i++){
+		totalBytes += GetUsage((MemorySubsystem)i).bytes;
+	}
+	DriverLog("Memory statistics: %.1fKB total", totalBytes / 1024.0);
+	for(int i = 0; i < MemorySubsystemCount; i++){
+		Usage usage = GetUsage((MemorySubsystem)i);
+		DriverLog("  %-10s %10.1fKB in %6lld objects, peak %10.1fKB in %6lld objects", MemorySubsystemName((MemorySubsystem)i),
+			usage.bytes / 1024.0, (long long)usage.objects, usage.peakBytes / 1024.0, (long long)usage.peakObjects);
+	}
+}
+
+int64_t MemoryAccounting::CheckLeaks(std::initializer_list<ExpectedObjects> expected){
+	int64_t leakedObjects = 0;
+	bool leaked = false;
+	for(const ExpectedObjects& expectedObjects : expected){
+		Usage usage = GetUsage(expectedObjects.subsystem);
+		if(usage.objects > expectedObjects.objects || (expectedObjects.objects == 0 && usage.bytes != 0)){
+			DriverLog("Memory still held at cleanup by %s: %.1fKB in %lld objects where %lld were expected", MemorySubsystemName(expectedObjects.subsystem), usage.bytes / 1024.0, (long long)usage.objects, (long long)expectedObjects.objects);
+			leakedObjects += std::max((int64_t)0, usage.objects - expectedObjects.objects);
+			leaked = true;
+		}
+	}
+	if(!leaked){
+		DriverLog("All tracked memory that is released at cleanup was released");
+	}
+	return leakedObjects;
+}
+
+
+TrackedMemory::TrackedMemory(MemorySubsystem subsystem, size_t bytes, size_t objects) : subsystem(subsystem), bytes(bytes), objects(objects){
+	driverMemory.Add(subsystem, (int64_t)bytes, (int64_t)objects);
+}
+
+TrackedMemory::TrackedMemory(const TrackedMemory& other) : subsystem(other.subsystem), bytes(other.bytes), objects(other.objects){
+	driverMemory.Add(subsystem, (int64_t)bytes, (int64_t)objects);
+}
+
+TrackedMemory& TrackedMemory::operator=(const TrackedMemory& other){
+	if(this != &other){
+		driverMemory.Add(subsystem, -(int64_t)bytes, -(int64_t)objects);
+		subsystem = other.subsystem;
+		bytes = other.bytes;
+		objects = other.objects;
+		driverMemory.Add(subsystem, (int64_t)bytes, (int64_t)objects);
+	}
+	return *this;
+}
+
+TrackedMemory::~TrackedMemory(){
+	driverMemory.Add(subsystem, -(int64_t)bytes, -(int64_t)objects);
+}
+
+void TrackedMemory::Resize(size_t newBytes, size_t newObjects){
+	driverMemory.Add(subsystem, (int64_t)newBytes - (int64_t)bytes, (int64_t)newObjects - (int64_t)objects);
+	bytes = newBytes;
+	objects = newObjects;
+}
+
+size_t TrackedMemory::GetBytes() const{
+	return bytes;
+}
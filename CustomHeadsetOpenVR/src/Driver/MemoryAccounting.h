@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <initializer_list>
+#include <cstddef>
+#include <cstdint>
+
+
+// parts of the driver that memory is counted against
+enum MemorySubsystem{
+	// distortion profiles and their lookup tables
+	MemorySubsystemDistortion,
+	// parsed settings and distortion profile files
+	MemorySubsystemConfig,
+	// shims wrapping devices and components given to SteamVR
+	MemorySubsystemShim,
+	// installed hooks and the driver contexts collected through them
+	MemorySubsystemHooking,
+	// vendor events waiting for the context of their device
+	MemorySubsystemEvents,
+	MemorySubsystemCount,
+};
+
+inline const char* MemorySubsystemName(MemorySubsystem subsystem){
+	switch(subsystem){
+		case MemorySubsystemDistortion: return "Distortion";
+		case MemorySubsystemConfig: return "Config";
+		case MemorySubsystemShim: return "Shim";
+		case MemorySubsystemHooking: return "Hooking";
+		case MemorySubsystemEvents: return "Events";
+		default: return "Unknown";
+	}
+}
+
+// std::map and std::set nodes hold three pointers and a color besides their value
+static const size_t memoryTreeNodeOverhead = 4 * sizeof(void*);
+
+// Counts the bytes and objects each subsystem holds along with the peak of each since the driver was loaded.
+// The counts are estimates that owners report as their memory changes, not a hook into the allocator.
+class MemoryAccounting{
+public:
+	struct Usage{
+		int64_t bytes;
+		int64_t peakBytes;
+		int64_t objects;
+		int64_t peakObjects;
+	};
+	// add to the counts of a subsystem, negative values release
+	void Add(MemorySubsystem subsystem, int64_t bytes, int64_t objects);
+	Usage GetUsage(MemorySubsystem subsystem);
+	void LogStatistics();
+	// number of objects a subsystem is expected to still hold when CheckLeaks is called
+	struct ExpectedObjects{
+		MemorySubsystem subsystem;
+		int64_t objects;
+	};
+	// log the subsystems that hold more objects than expected, or any bytes when no objects are expected
+	// subsystems with owners that live until the process exits are left out since their count is not known
+	// returns the number of objects held beyond what was expected
+	int64_t CheckLeaks(std::initializer_list<ExpectedObjects> expected);
+private:
+	struct Counters{
+		std::atomic<int64_t> bytes;
+		std::atomic<int64_t> peakBytes;
+		std::atomic<int64_t> objects;
+		std::atomic<int64_t> peakObjects;
+	};
+	// zero initialised before any constructor runs so globals can count memory while they are constructed
+	Counters counters[MemorySubsystemCount];
+};
+
+// global memory accounting
+extern MemoryAccounting driverMemory;
+
+
+// Memory of one owner counted against a subsystem for as long as the owner lives.
+// Owners resize it as their memory changes, copies of the owner are counted separately.
+class TrackedMemory{
+public:
+	explicit TrackedMemory(MemorySubsystem subsystem, size_t bytes = 0, size_t objects = 1);
+	TrackedMemory(const TrackedMemory& other);
+	TrackedMemory& operator=(const TrackedMemory& other);
+	~TrackedMemory();
+	// set the bytes and objects this owner holds
+	void Resize(size_t bytes, size_t objects = 1);
+	size_t GetBytes() const;
+private:
+	MemorySubsystem subsystem;
+	size_t bytes;
+	size_t objects;
+};
@@ -0,0 +1,62 @@
+#include "RenderTargetController.h"
+#include <algorithm>
+#include <cmath>
+
+
+void RenderTargetController::Reset(double scale){
+	this->scale = std::clamp(scale, minScale, maxScale);
+	lastLoad = 0;
+	window.clear();
+	settling = false;
+}
+
+bool RenderTargetController::AddSample(const FrameTimingSample& sample, double frameBudgetMs){
+	// a missed frame counts as a frame that went over budget no matter what the gpu time says
+	double gpuMs = sample.missed ? std::max(sample.applicationGpuMs, frameBudgetMs * 1.5) : sample.applicationGpuMs;
+	window.push_back(gpuMs);
+	if(window.size() < std::max((size_t)1, windowFrames)){
+		return false;
+	}
+	bool changed = false;
+	if(settling){
+		settling = false;
+	}else{
+		changed = EvaluateWindow(frameBudgetMs);
+		settling = changed;
+	}
+	window.clear();
+	return changed;
+}
+
+bool RenderTargetController::EvaluateWindow(double frameBudgetMs){
+	if(frameBudgetMs <= 0){
+		return false;
+	}
+	size_t index = std::min(window.size() - 1, (size_t)(percentile * window.size()));
+	std::nth_element(window.begin(), window.begin() + index, window.end());
+	lastLoad = window[index] / frameBudgetMs;
+	if(std::abs(lastLoad - targetLoad) <= hysteresis || lastLoad <= 0){
+		return false;
+	}
+	// gpu time is roughly proportional to the pixel count, which is the square of the scale
+	double newScale = scale * std::sqrt(targetLoad / lastLoad);
+	newScale = std::min(newScale, scale + maxIncrease);
+	if(scaleStep > 0){
+		// round towards the current scale so a step is never larger than what was asked for
+		newScale = newScale > scale ? std::floor(newScale / scaleStep + 1e-6) * scaleStep : std::ceil(newScale / scaleStep - 1e-6) * scaleStep;
+	}
+	newScale = std::clamp(newScale, minScale, maxScale);
+	if(std::abs(newScale - scale) < 1e-6){
+		return false;
+	}
+	scale = newScale;
+	return true;
+}
+
+double RenderTargetController::GetScale(){
+	return scale;
+}
+
+double RenderTargetController::GetLastLoad(){
+	return lastLoad;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "FrameTimingSource.h"
+#include <vector>
+
+
+// Chooses a render target scale from frame timings so the application uses the gpu headroom it has.
+// It only does math on the samples it is given, so it can be driven by recorded or synthetic timing traces.
+//
+// Samples are collected into a window, once the window is full the high percentile of the gpu time is compared to the frame budget.
+// Nothing changes while the load is within the hysteresis band around the target,
+// outside of it the scale is set to where gpu time would be on target assuming it is proportional to the pixel count.
+// After a change the next window is skipped since the application takes a while to pick up the new size.
+class RenderTargetController{
+public:
+	// limits of the scale in each dimension
+	double minScale = 0.7;
+	double maxScale = 1.2;
+	// fraction of the frame budget the application gpu time should use
+	double targetLoad = 0.8;
+	// the scale is only changed if the load is further than this from targetLoad
+	double hysteresis = 0.1;
+	// largest increase of the scale in a single step, decreases are not limited so missed frames are resolved quickly
+	double maxIncrease = 0.05;
+	// scales are rounded to this step so small changes in load don't cause new sizes
+	double scaleStep = 0.05;
+	// frames in each window
+	size_t windowFrames = 90;
+	// percentile of the gpu time used for the load of a window
+	double percentile = 0.9;
+	
+	// start over at scale with an empty window
+	void Reset(double scale);
+	// add a frame, frameBudgetMs is the time between vsyncs
+	// returns true if the scale was changed
+	bool AddSample(const FrameTimingSample& sample, double frameBudgetMs);
+	double GetScale();
+	// load of the last full window as a fraction of the frame budget
+	double GetLastLoad();
+private:
+	double scale = 1.0;
+	double lastLoad = 0;
+	std::vector<double> window;
+	// true while the window after a change is being skipped
+	bool settling = false;
+	// compute the new scale from a full window, returns true if it changed
+	bool EvaluateWindow(double frameBudgetMs);
+};
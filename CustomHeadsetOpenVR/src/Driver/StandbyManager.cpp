@@ -0,0 +1,48 @@
+#include "StandbyManager.h"
+#include "DriverLog.h"
+#include "FlightRecorder.h"
+#include <chrono>
+
+
+void StandbyManager::Register(const std::string& name, std::function<size_t()> release, std::function<void()> restore){
+	std::lock_guard<std::mutex> guard(lock);
+	resources.push_back({name, std::move(release), std::move(restore)});
+}
+
+bool StandbyManager::IsInStandby(){
+	std::lock_guard<std::mutex> guard(lock);
+	return inStandby;
+}
+
+void StandbyManager::EnterStandby(){
+	std::lock_guard<std::mutex> guard(lock);
+	if(inStandby){
+		return;
+	}
+	inStandby = true;
+	driverFlightRecorder.Record(FlightRecorderStandbyEnter);
+	size_t totalReleased = 0;
+	for(Resource& resource : resources){
+		size_t released = resource.release();
+		if(released > 0){
+			DriverLog("Standby released %zu bytes from %s", released, resource.name.c_str());
+		}
+		totalReleased += released;
+	}
+	DriverLog("Entered standby, reclaimed %zu bytes from %d resources", totalReleased, (int)resources.size());
+}
+
+void StandbyManager::LeaveStandby(){
+	std::lock_guard<std::mutex> guard(lock);
+	if(!inStandby){
+		return;
+	}
+	inStandby = false;
+	driverFlightRecorder.Record(FlightRecorderStandbyLeave);
+	auto start = std::chrono::steady_clock::now();
+	for(auto resource = resources.rbegin(); resource != resources.rend(); resource++){
+		resource->restore();
+	}
+	double milliseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+	DriverLog("Left standby, restored %d resources in %.2fms", (int)resources.size(), milliseconds);
+}
\ No newline at end of file
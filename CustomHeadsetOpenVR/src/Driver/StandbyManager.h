@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+
+// Releases resources while SteamVR is in standby and restores them when it leaves standby.
+// Resources are released in the order they were registered and restored in the reverse order.
+class StandbyManager{
+public:
+	// register a resource, release returns the number of bytes it freed
+	// restore should start rebuilding anything that is needed right away when waking up
+	void Register(const std::string& name, std::function<size_t()> release, std::function<void()> restore);
+	// release all resources and log how much memory was reclaimed
+	void EnterStandby();
+	// restore all resources
+	void LeaveStandby();
+	bool IsInStandby();
+private:
+	struct Resource{
+		std::string name;
+		std::function<size_t()> release;
+		std::function<void()> restore;
+	};
+	std::vector<Resource> resources;
+	bool inStandby = false;
+	std::mutex lock;
+};
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "StartupTimeline.h"
+#include "DriverLog.h"
+#include "WorkerPool.h"
+#include "../Config/ConfigLoader.h"
+#include <chrono>
+#include <thread>
+#include <fstream>
+
+
+static int64_t NowMicroseconds(){
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void StartupTimeline::Mark(const char* phase){
+	if(finished){
+		return;
+	}
+	int64_t now = NowMicroseconds();
+	std::lock_guard<std::mutex> guard(lock);
+	if(startMicroseconds < 0){
+		startMicroseconds = now;
+	}
+	uint32_t threadId = (uint32_t)(std::hash<std::thread::id>{}(std::this_thread::get_id()) % 100000);
+	phases.push_back({phase, now - startMicroseconds, threadId});
+}
+
+bool StartupTimeline::IsFinished(){
+	return finished;
+}
+
+void StartupTimeline::Finish(const char* phase){
+	if(finished){
+		return;
+	}
+	Mark(phase);
+	std::vector<Phase> finishedPhases;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if(finished){
+			return;
+		}
+		finished = true;
+		finishedPhases = phases;
+	}
+	
+	// log as a single line with the time from the start and from the previous phase
+	std::string line = "Startup timeline:";
+	int64_t previous = 0;
+	char entry[128];
+	for(const Phase& finishedPhase : finishedPhases){
+		snprintf(entry, sizeof(entry), " %s %.1fms (+%.1fms)", finishedPhase.name, finishedPhase.microseconds / 1000.0, (finishedPhase.microseconds - previous) / 1000.0);
+		line += entry;
+		previous = finishedPhase.microseconds;
+	}
+	DriverLog("%s", line.c_str());
+	
+	if(driverConfig.writeStartupTrace){
+		driverWorkerPool.Submit("StartupTimeline::WriteTrace", WorkerPriorityIdle, [this, finishedPhases](WorkerJob& job){
+			WriteTrace(finishedPhases);
+		});
+	}
+}
+
+// write the timeline in the chrome trace event format
+void StartupTimeline::WriteTrace(const std::vector<Phase>& tracePhases){
+	std::string tracePath = driverConfigLoader.GetConfigFolder() + "StartupTrace.json";
+	std::ofstream traceFile(tracePath);
+	if(!traceFile.is_open()){
+		DriverLog("Failed to write startup trace to %s", tracePath.c_str());
+		return;
+	}
+	traceFile << "{\"traceEvents\":[\n";
+	for(size_t i = 0; i < tracePhases.size(); i++){
+		const Phase& tracePhase = tracePhases[i];
+		// each phase lasts until the next one so it shows up as a bar
+		int64_t duration = i + 1 < tracePhases.size() ? tracePhases[i + 1].microseconds - tracePhase.microseconds : 0;
+		traceFile << "{\"name\":\"" << tracePhase.name << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tracePhase.threadId << ",\"ts\":" << tracePhase.microseconds << ",\"dur\":" << duration << "}";
+		traceFile << (i + 1 < tracePhases.size() ? ",\n" : "\n");
+	}
+	traceFile << "]}\n";
+	DriverLog("Wrote startup trace to %s", tracePath.c_str());
+}
+
+
+StartupTimeline driverStartupTimeline = {};
\ No newline at end of file
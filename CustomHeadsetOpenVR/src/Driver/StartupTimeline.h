@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+
+// Records when each phase of driver startup happens, from HmdDriverFactory to the first ComputeDistortion.
+// When finished the timeline is logged as one line and optionally written as a trace that can be opened in chrome://tracing or Perfetto.
+class StartupTimeline{
+public:
+	// record that a phase was reached, the first mark is the start of the timeline
+	// marks after the timeline has finished are ignored
+	void Mark(const char* phase);
+	// record the last phase and log the timeline
+	void Finish(const char* phase);
+	bool IsFinished();
+private:
+	struct Phase{
+		const char* name;
+		// time since the first mark
+		int64_t microseconds;
+		uint32_t threadId;
+	};
+	std::vector<Phase> phases;
+	int64_t startMicroseconds = -1;
+	std::atomic<bool> finished = false;
+	std::mutex lock;
+	void WriteTrace(const std::vector<Phase>& tracePhases);
+};
+
+// global startup timeline
+extern StartupTimeline driverStartupTimeline;
\ No newline at end of file
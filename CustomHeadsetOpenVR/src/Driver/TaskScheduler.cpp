@@ -0,0 +1,260 @@
+#include "TaskScheduler.h"
+#include "DriverLog.h"
+#include "WorkerPool.h"
+#include "FlightRecorder.h"
+#include <chrono>
+#include <algorithm>
+
+// minimum time between repeated overrun or deferral logs so a slow task does not flood the log
+static const int64_t overrunLogIntervalMicroseconds = 1000000;
+
+
+int64_t TaskScheduler::NowMicroseconds(){
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TaskScheduler::TaskId TaskScheduler::AddFrameHook(const std::string& name, int64_t budgetMicroseconds, std::function<void()> function){
+	std::lock_guard<std::mutex> guard(lock);
+	TaskId id = nextId++;
+	frameHooks.push_back(std::make_shared<FrameHook>(FrameHook{id, name, budgetMicroseconds, std::move(function)}));
+	return id;
+}
+
+void TaskScheduler::RemoveFrameHook(TaskId id){
+	std::lock_guard<std::mutex> guard(lock);
+	for(size_t i = 0; i < frameHooks.size(); i++){
+		if(frameHooks[i]->id == id){
+			frameHooks.erase(frameHooks.begin() + i);
+			return;
+		}
+	}
+}
+
+TaskScheduler::TaskId TaskScheduler::RunAfter(const std::string& name, double delaySeconds, std::function<void()> function, int64_t budgetMicroseconds){
+	std::lock_guard<std::mutex> guard(lock);
+	TaskId id = nextId++;
+	int64_t dueTick = (NowMicroseconds() + (int64_t)(delaySeconds * 1000000.0)) / wheelTickMicroseconds;
+	AddTimer({id, name, dueTick, 0, budgetMicroseconds, std::move(function)});
+	return id;
+}
+
+TaskScheduler::TaskId TaskScheduler::RunEvery(const std::string& name, double intervalSeconds, std::function<void()> function, int64_t budgetMicroseconds){
+	std::lock_guard<std::mutex> guard(lock);
+	TaskId id = nextId++;
+	int64_t intervalTicks = std::max((int64_t)1, (int64_t)(intervalSeconds * 1000000.0) / wheelTickMicroseconds);
+	int64_t dueTick = NowMicroseconds() / wheelTickMicroseconds + intervalTicks;
+	AddTimer({id, name, dueTick, intervalTicks, budgetMicroseconds, std::move(function)});
+	return id;
+}
+
+// must be called with lock held
+void TaskScheduler::AddTimer(Timer timer){
+	if(currentTick < 0){
+		currentTick = NowMicroseconds() / wheelTickMicroseconds;
+	}
+	if(timer.dueTick <= currentTick){
+		// the wheel has already passed this tick so it is due right away
+		dueTimers.push_back(std::move(timer));
+	}else{
+		wheel[timer.dueTick % wheelSlots].push_back(std::move(timer));
+	}
+}
+
+void TaskScheduler::CancelTimer(TaskId id){
+	std::lock_guard<std::mutex> guard(lock);
+	if(runningTimer == id){
+		runningTimerCancelled = true;
+	}
+	for(size_t i = 0; i < dueTimers.size(); i++){
+		if(dueTimers[i].id == id){
+			dueTimers.erase(dueTimers.begin() + i);
+			return;
+		}
+	}
+	for(int slot = 0; slot < wheelSlots; slot++){
+		for(size_t i = 0; i < wheel[slot].size(); i++){
+			if(wheel[slot][i].id == id){
+				wheel[slot].erase(wheel[slot].begin() + i);
+				return;
+			}
+		}
+	}
+}
+
+// move every timer that is due by nowTick into dueTimers, must be called with lock held
+void TaskScheduler::AdvanceWheel(int64_t nowTick){
+	if(currentTick < 0){
+		currentTick = nowTick;
+		return;
+	}
+	int64_t ticks = nowTick - currentTick;
+	if(ticks <= 0){
+		return;
+	}
+	// visit each slot at most once even if more than a full turn has passed
+	int steps = ticks >= wheelSlots ? wheelSlots : (int)ticks;
+	for(int step = 1; step <= steps; step++){
+		std::vector<Timer>& slot = wheel[(currentTick + step) % wheelSlots];
+		for(size_t i = 0; i < slot.size();){
+			if(slot[i].dueTick <= nowTick){
+				dueTimers.push_back(std::move(slot[i]));
+				slot[i] = std::move(slot.back());
+				slot.pop_back();
+			}else{
+				i++;
+			}
+		}
+	}
+	currentTick = nowTick;
+}
+
+void TaskScheduler::RecordRun(const std::string& name, int64_t durationMicroseconds, int64_t budgetMicroseconds){
+	std::lock_guard<std::mutex> guard(lock);
+	TaskStatistics& taskStatistics = statistics[name];
+	taskStatistics.runs++;
+	taskStatistics.totalMicroseconds += durationMicroseconds;
+	taskStatistics.maxMicroseconds = std::max(taskStatistics.maxMicroseconds, durationMicroseconds);
+	if(budgetMicroseconds >= 0 && durationMicroseconds > budgetMicroseconds){
+		taskStatistics.overruns++;
+		// every overrun is recorded, only the log is rate limited
+		driverFlightRecorder.Record(FlightRecorderTaskOverrun, name.c_str(), durationMicroseconds, budgetMicroseconds);
+		int64_t now = NowMicroseconds();
+		if(taskStatistics.lastOverrunLogTime < 0 || now - taskStatistics.lastOverrunLogTime >= overrunLogIntervalMicroseconds){
+			DriverLog("%s took %lldus which is over its budget of %lldus (%llu more overruns since last report)", name.c_str(), (long long)durationMicroseconds, (long long)budgetMicroseconds, (unsigned long long)taskStatistics.unloggedOverruns);
+			taskStatistics.unloggedOverruns = 0;
+			taskStatistics.lastOverrunLogTime = now;
+		}else{
+			taskStatistics.unloggedOverruns++;
+		}
+	}
+}
+
+bool TaskScheduler::RunFrame(){
+	int64_t frameStart = NowMicroseconds();
+
+	// copy the hooks so they can be added or removed by the hooks themselves
+	std::vector<std::shared_ptr<FrameHook>> hooks;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		hooks = frameHooks;
+	}
+
+	bool allHooksRan = true;
+	int deferredHooks = 0;
+	size_t hookCount = hooks.size();
+	size_t firstHook = hookCount > 0 ? nextFrameHook % hookCount : 0;
+	nextFrameHook = 0;
+	for(size_t i = 0; i < hookCount; i++){
+		FrameHook& hook = *hooks[(firstHook + i) % hookCount];
+		// always run at least one hook so that deferred hooks make progress
+		if(i > 0 && NowMicroseconds() - frameStart >= frameBudgetMicroseconds){
+			// start with the deferred hooks next frame
+			nextFrameHook = (firstHook + i) % hookCount;
+			allHooksRan = false;
+			deferredHooks = (int)(hookCount - i);
+			std::lock_guard<std::mutex> guard(lock);
+			for(size_t j = i; j < hookCount; j++){
+				statistics[hooks[(firstHook + j) % hookCount]->name].deferrals++;
+			}
+			break;
+		}
+		int64_t hookStart = NowMicroseconds();
+		hook.function();
+		RecordRun(hook.name, NowMicroseconds() - hookStart, hook.budgetMicroseconds);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		AdvanceWheel(NowMicroseconds() / wheelTickMicroseconds);
+	}
+	int deferredTimers = 0;
+	while(true){
+		Timer timer;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			// paused timers stay in dueTimers until they are resumed
+			if(dueTimers.empty() || timersPaused){
+				break;
+			}
+			if(NowMicroseconds() - frameStart >= frameBudgetMicroseconds){
+				// leave the rest in dueTimers for the next frame
+				deferredTimers = (int)dueTimers.size();
+				for(Timer& dueTimer : dueTimers){
+					statistics[dueTimer.name].deferrals++;
+				}
+				break;
+			}
+			timer = std::move(dueTimers.front());
+			dueTimers.pop_front();
+			runningTimer = timer.id;
+			runningTimerCancelled = false;
+		}
+		int64_t timerStart = NowMicroseconds();
+		timer.function();
+		int64_t timerEnd = NowMicroseconds();
+		RecordRun(timer.name, timerEnd - timerStart, timer.budgetMicroseconds);
+		std::lock_guard<std::mutex> guard(lock);
+		if(timer.intervalTicks > 0 && !runningTimerCancelled){
+			// schedule from now so a late timer does not run several times in a row to catch up
+			timer.dueTick = timerEnd / wheelTickMicroseconds + timer.intervalTicks;
+			AddTimer(std::move(timer));
+		}
+		runningTimer = 0;
+	}
+
+	if(deferredHooks > 0 || deferredTimers > 0){
+		std::lock_guard<std::mutex> guard(lock);
+		int64_t now = NowMicroseconds();
+		driverFlightRecorder.Record(FlightRecorderFrameDeferral, nullptr, deferredHooks, deferredTimers);
+		if(lastDeferralLogTime < 0 || now - lastDeferralLogTime >= overrunLogIntervalMicroseconds){
+			DriverLog("Frame budget of %lldus used up after %lldus, deferred %d frame hooks and %d timers to the next frame (%llu more deferrals since last report)", (long long)frameBudgetMicroseconds, (long long)(now - frameStart), deferredHooks, deferredTimers, (unsigned long long)unloggedDeferrals);
+			unloggedDeferrals = 0;
+			lastDeferralLogTime = now;
+		}else{
+			unloggedDeferrals++;
+		}
+	}
+	return allHooksRan;
+}
+
+void TaskScheduler::RunInBackground(const std::string& name, std::function<void()> function){
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if(stopping){
+			return;
+		}
+	}
+	driverWorkerPool.Submit(name, WorkerPriorityNormal, [this, name, function](WorkerJob& job){
+		int64_t jobStart = NowMicroseconds();
+		function();
+		RecordRun(name, NowMicroseconds() - jobStart, -1);
+	});
+}
+
+void TaskScheduler::SetTimersPaused(bool paused){
+	std::lock_guard<std::mutex> guard(lock);
+	timersPaused = paused;
+}
+
+void TaskScheduler::LogStatistics(){
+	std::lock_guard<std::mutex> guard(lock);
+	for(auto& entry : statistics){
+		const TaskStatistics& taskStatistics = entry.second;
+		long long average = taskStatistics.runs > 0 ? (long long)(taskStatistics.totalMicroseconds / (int64_t)taskStatistics.runs) : 0;
+		DriverLog("Scheduler statistics for %s: runs %llu, average %lldus, max %lldus, overruns %llu, deferrals %llu", entry.first.c_str(), (unsigned long long)taskStatistics.runs, average, (long long)taskStatistics.maxMicroseconds, (unsigned long long)taskStatistics.overruns, (unsigned long long)taskStatistics.deferrals);
+	}
+}
+
+void TaskScheduler::Stop(){
+	std::lock_guard<std::mutex> guard(lock);
+	stopping = true;
+	dueTimers.clear();
+	for(int slot = 0; slot < wheelSlots; slot++){
+		wheel[slot].clear();
+	}
+	frameHooks.clear();
+}
+
+TaskScheduler::~TaskScheduler(){
+	Stop();
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+
+// Schedules work for the device provider so that nothing can lengthen a server frame unnoticed.
+// There are three kinds of work:
+// - frame hooks run from RunFrame every frame and each have a budget in microseconds
+// - timers are deferred or periodic jobs that are kept on a timer wheel and run from RunFrame once due
+// - background jobs run on the driver worker pool and never touch the server frame
+// When a frame has used up frameBudgetMicroseconds the remaining frame hooks and due timers are deferred to the next frame.
+// Any frame hook or timer that takes longer than its own budget is logged with how long it took.
+// Frame hooks and timers run on the main loop with driverConfigLock held, so they must not call ParseConfig.
+class TaskScheduler{
+public:
+	typedef uint64_t TaskId;
+
+	// time in microseconds that frame hooks and timers can use each frame before the rest is deferred
+	int64_t frameBudgetMicroseconds = 1000;
+
+	// add a function that is run every frame
+	TaskId AddFrameHook(const std::string& name, int64_t budgetMicroseconds, std::function<void()> function);
+	void RemoveFrameHook(TaskId id);
+	// run a function once on the main loop after delaySeconds
+	TaskId RunAfter(const std::string& name, double delaySeconds, std::function<void()> function, int64_t budgetMicroseconds = 1000);
+	// run a function on the main loop every intervalSeconds until it is cancelled
+	TaskId RunEvery(const std::string& name, double intervalSeconds, std::function<void()> function, int64_t budgetMicroseconds = 1000);
+	// cancel a timer created by RunAfter or RunEvery, it is safe to cancel a timer that has already finished
+	void CancelTimer(TaskId id);
+	// run a function on the driver worker pool
+	void RunInBackground(const std::string& name, std::function<void()> function);
+
+	// run frame hooks and due timers, called by CustomHeadsetDeviceProvider::RunFrame
+	// returns false if any frame hooks were deferred to the next frame
+	bool RunFrame();
+	// pause timers while in standby, frame hooks keep running
+	// timers that became due while paused run once when resumed
+	void SetTimersPaused(bool paused);
+	// log the run counts and durations of all work
+	void LogStatistics();
+	// drop all remaining work and stop accepting new work
+	void Stop();
+	~TaskScheduler();
+
+private:
+	// timing statistics kept for every named piece of work
+	struct TaskStatistics{
+		uint64_t runs = 0;
+		uint64_t overruns = 0;
+		uint64_t deferrals = 0;
+		int64_t totalMicroseconds = 0;
+		int64_t maxMicroseconds = 0;
+		// overruns that have not been logged yet due to rate limiting
+		uint64_t unloggedOverruns = 0;
+		int64_t lastOverrunLogTime = -1;
+	};
+	struct FrameHook{
+		TaskId id;
+		std::string name;
+		int64_t budgetMicroseconds;
+		std::function<void()> function;
+	};
+	struct Timer{
+		TaskId id;
+		std::string name;
+		// tick that the timer should run at
+		int64_t dueTick;
+		// ticks between runs for periodic timers, 0 for one shot timers
+		int64_t intervalTicks;
+		int64_t budgetMicroseconds;
+		std::function<void()> function;
+	};
+
+	// the timer wheel is a ring of slots that each hold the timers due on ticks that map to it
+	// a full turn of the wheel covers wheelSlots * wheelTickMicroseconds, longer timers stay in their slot until their dueTick is reached
+	static const int wheelSlots = 256;
+	static const int64_t wheelTickMicroseconds = 1000;
+	std::vector<Timer> wheel[wheelSlots];
+	// the last tick that the wheel was advanced to
+	int64_t currentTick = -1;
+	// timers that are due but were deferred because the frame budget ran out
+	std::deque<Timer> dueTimers;
+	// the timer currently being run and if it was cancelled while running
+	TaskId runningTimer = 0;
+	bool runningTimerCancelled = false;
+
+	std::vector<std::shared_ptr<FrameHook>> frameHooks;
+	// index of the frame hook to start at, this moves forward when hooks are deferred so every hook gets to run
+	size_t nextFrameHook = 0;
+
+	bool stopping = false;
+	bool timersPaused = false;
+
+	// deferrals that have not been logged yet due to rate limiting
+	uint64_t unloggedDeferrals = 0;
+	int64_t lastDeferralLogTime = -1;
+	// statistics by the name of the work
+	std::map<std::string, TaskStatistics> statistics;
+	TaskId nextId = 1;
+	std::mutex lock;
+
+	int64_t NowMicroseconds();
+	void AddTimer(Timer timer);
+	void AdvanceWheel(int64_t nowTick);
+	// record a run and log it if it went over budget, a negative budget means there is no budget
+	void RecordRun(const std::string& name, int64_t durationMicroseconds, int64_t budgetMicroseconds);
+};
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "WorkerPool.h"
+#include "DriverLog.h"
+#include "Windows.h"
+#include <string>
+
+
+void WorkerJob::Cancel(){
+	cancelled = true;
+}
+
+bool WorkerJob::IsCancelled(){
+	return cancelled;
+}
+
+bool WorkerJob::IsFinished(){
+	return finished;
+}
+
+void WorkerJob::Wait(){
+	std::unique_lock<std::mutex> guard(finishedLock);
+	while(!finished){
+		finishedCondition.wait(guard);
+	}
+}
+
+void WorkerJob::Finish(){
+	std::lock_guard<std::mutex> guard(finishedLock);
+	finished = true;
+	// release anything captured by the function now that it is done
+	function = nullptr;
+	finishedCondition.notify_all();
+}
+
+
+void WorkerPool::Start(int threadCount, const std::vector<int>& avoidCores){
+	std::lock_guard<std::mutex> guard(lock);
+	if(started){
+		return;
+	}
+	started = true;
+	stopping = false;
+
+	affinityMask = 0;
+	if(avoidCores.size() > 0){
+		DWORD_PTR processMask = 0;
+		DWORD_PTR systemMask = 0;
+		if(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)){
+			uint64_t mask = processMask;
+			for(int core : avoidCores){
+				if(core >= 0 && core < 64){
+					mask &= ~(1ull << core);
+				}
+			}
+			if(mask != 0){
+				affinityMask = mask;
+			}else{
+				DriverLog("Worker pool can not avoid every core, using the default affinity");
+			}
+		}
+	}
+
+	if(threadCount < 1){
+		threadCount = 1;
+	}
+	for(int i = 0; i < threadCount; i++){
+		workers.push_back(std::thread(&WorkerPool::WorkerThread, this, i));
+	}
+	DriverLog("Started worker pool with %d threads and affinity mask %llx", threadCount, (unsigned long long)affinityMask);
+}
+
+WorkerJobHandle WorkerPool::Submit(const std::string& name, WorkerPriority priority, std::function<void(WorkerJob&)> function){
+	WorkerJobHandle job = std::make_shared<WorkerJob>();
+	job->name = name;
+	job->priority = priority;
+	job->function = std::move(function);
+	std::unique_lock<std::mutex> guard(lock);
+	if(stopping){
+		job->Cancel();
+		job->Finish();
+		return job;
+	}
+	if(!started){
+		// no workers to run it on so run it now
+		guard.unlock();
+		job->function(*job);
+		job->Finish();
+		return job;
+	}
+	queues[priority].push_back(job);
+	jobAvailable.notify_one();
+	return job;
+}
+
+void WorkerPool::WorkerThread(int index){
+	HANDLE thread = GetCurrentThread();
+	// name the thread so the workers can be told apart in profilers and debuggers
+	std::wstring name = L"CustomHeadset Worker " + std::to_wstring(index);
+	SetThreadDescription(thread, name.c_str());
+	if(affinityMask != 0){
+		SetThreadAffinityMask(thread, (DWORD_PTR)affinityMask);
+	}
+	int currentPriority = THREAD_PRIORITY_BELOW_NORMAL;
+	SetThreadPriority(thread, currentPriority);
+
+	std::unique_lock<std::mutex> guard(lock);
+	while(!stopping){
+		WorkerJobHandle job = nullptr;
+		for(int lane = 0; lane < WorkerPriorityCount; lane++){
+			if(!queues[lane].empty()){
+				job = queues[lane].front();
+				queues[lane].pop_front();
+				break;
+			}
+		}
+		if(job == nullptr){
+			jobAvailable.wait(guard);
+			continue;
+		}
+		jobsRun[job->priority]++;
+		runningJobs.push_back(job);
+		guard.unlock();
+
+		// latency critical jobs run at the normal priority, everything else stays below the server
+		int jobPriority = THREAD_PRIORITY_BELOW_NORMAL;
+		if(job->priority == WorkerPriorityLatencyCritical){
+			jobPriority = THREAD_PRIORITY_NORMAL;
+		}else if(job->priority == WorkerPriorityIdle){
+			jobPriority = THREAD_PRIORITY_LOWEST;
+		}
+		if(jobPriority != currentPriority){
+			SetThreadPriority(thread, jobPriority);
+			currentPriority = jobPriority;
+		}
+
+		if(!job->IsCancelled()){
+			try{
+				job->function(*job);
+			}catch(const std::exception& e){
+				DriverLog("Worker job %s failed: %s", job->name.c_str(), e.what());
+			}
+		}
+		job->Finish();
+
+		guard.lock();
+		for(size_t i = 0; i < runningJobs.size(); i++){
+			if(runningJobs[i] == job){
+				runningJobs.erase(runningJobs.begin() + i);
+				break;
+			}
+		}
+	}
+}
+
+void WorkerPool::Stop(){
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if(stopping){
+			return;
+		}
+		stopping = true;
+		// drop queued jobs and ask running ones to return early
+		for(int lane = 0; lane < WorkerPriorityCount; lane++){
+			for(WorkerJobHandle& job : queues[lane]){
+				job->Cancel();
+				job->Finish();
+			}
+			queues[lane].clear();
+		}
+		for(WorkerJobHandle& job : runningJobs){
+			job->Cancel();
+		}
+		jobAvailable.notify_all();
+	}
+	for(std::thread& worker : workers){
+		if(worker.joinable()){
+			worker.join();
+		}
+	}
+	workers.clear();
+}
+
+void WorkerPool::LogStatistics(){
+	std::lock_guard<std::mutex> guard(lock);
+	DriverLog("Worker pool statistics: latency critical %llu run %d queued, normal %llu run %d queued, idle %llu run %d queued, %d running",
+		(unsigned long long)jobsRun[WorkerPriorityLatencyCritical], (int)queues[WorkerPriorityLatencyCritical].size(),
+		(unsigned long long)jobsRun[WorkerPriorityNormal], (int)queues[WorkerPriorityNormal].size(),
+		(unsigned long long)jobsRun[WorkerPriorityIdle], (int)queues[WorkerPriorityIdle].size(),
+		(int)runningJobs.size());
+}
+
+WorkerPool::~WorkerPool(){
+	Stop();
+}
+
+
+WorkerPool driverWorkerPool = {};
\ No newline at end of file
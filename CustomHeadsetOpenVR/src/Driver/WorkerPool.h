@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+
+
+// lanes that jobs are submitted to, workers always take jobs from the highest priority lane first
+enum WorkerPriority{
+	// work that something is waiting on, like a profile that is needed for the next distortion mesh
+	WorkerPriorityLatencyCritical,
+	// general background work like parsing files
+	WorkerPriorityNormal,
+	// work that can happen whenever there is time, like writing caches
+	WorkerPriorityIdle,
+	WorkerPriorityCount,
+};
+
+// a job that has been submitted to the worker pool
+// jobs are cancelled cooperatively, long running jobs should check IsCancelled and return early
+class WorkerJob{
+public:
+	std::string name;
+	WorkerPriority priority = WorkerPriorityNormal;
+	// request that the job stops, if it has not started yet it will not be run
+	void Cancel();
+	bool IsCancelled();
+	bool IsFinished();
+	// block until the job has finished or was cancelled before it started
+	void Wait();
+private:
+	friend class WorkerPool;
+	std::function<void(WorkerJob&)> function;
+	std::atomic<bool> cancelled = false;
+	std::atomic<bool> finished = false;
+	std::mutex finishedLock;
+	std::condition_variable finishedCondition;
+	void Finish();
+};
+typedef std::shared_ptr<WorkerJob> WorkerJobHandle;
+
+// a driver wide pool of background threads that run jobs by priority
+// workers run below the priority of the server and can avoid cores that are used by the compositor
+class WorkerPool{
+public:
+	// start the workers, avoidCores is a list of core indices that workers should not run on
+	void Start(int threadCount, const std::vector<int>& avoidCores);
+	// submit a job to run on a worker, the job is passed to the function so it can check for cancellation
+	// if the pool has not been started the job is run immediately on the calling thread
+	WorkerJobHandle Submit(const std::string& name, WorkerPriority priority, std::function<void(WorkerJob&)> function);
+	// cancel all queued and running jobs, wait for running jobs to return and stop the workers
+	void Stop();
+	// log the number of jobs run and queued in each lane
+	void LogStatistics();
+	~WorkerPool();
+private:
+	std::vector<std::thread> workers;
+	std::deque<WorkerJobHandle> queues[WorkerPriorityCount];
+	std::vector<WorkerJobHandle> runningJobs;
+	uint64_t jobsRun[WorkerPriorityCount] = {};
+	// mask of cores workers are allowed to run on, 0 to use the default
+	uint64_t affinityMask = 0;
+	bool started = false;
+	bool stopping = false;
+	std::mutex lock;
+	std::condition_variable jobAvailable;
+	void WorkerThread(int index);
+};
+
+// global worker pool, started in CustomHeadsetDeviceProvider::Init and stopped in Cleanup
+extern WorkerPool driverWorkerPool;
\ No newline at end of file
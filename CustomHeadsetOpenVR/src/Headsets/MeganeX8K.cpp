@@ -1,12 +1,23 @@
 #include "MeganeX8K.h"
 #include <chrono>
 #include <cmath>
+#include <algorithm>
 #include "../Distortion/RadialBezierDistortionProfile.h"
 #include "../Config/Config.h"
+#include "../Driver/StartupTimeline.h"
+#include "../Driver/FlightRecorder.h"
+#include "MeganeX8KDistortion.h"
 
 
+bool MeganeX8KShim::PreTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitError &returnValue){
+	driverStartupTimeline.Mark("Activate");
+	return true;
+}
+
 void MeganeX8KShim::PosTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitError &returnValue){
 	DriverLog("PosTrackedDeviceActivate");
+	driverStartupTimeline.Mark("PosTrackedDeviceActivate");
+	driverFlightRecorder.Record(FlightRecorderDeviceActivate, "MeganeX8K", unObjectId, returnValue);
 
 
 	// get property container
@@ -16,20 +27,12 @@ void MeganeX8KShim::PosTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitEr
 	if(modelNumber != "MeganeX superlight 8K"){
 		// deactivate shim if this is not a MeganeX superlight 8K
 		shimActive = false;
+		driverStartupTimeline.Finish("NotMeganeX8K");
 		return;
 	}
 	
 	isActive = true;
-	// TODO: apply a propper hidden area mesh
-	vr::HmdVector2_t mesh[1];
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_Standard, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_Standard, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_Inverse, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_Inverse, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_LineLoop, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_LineLoop, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_Max, mesh, 0);
-	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_Max, mesh, 0);
+	ApplyPanelMode();
 	
 	
 	// avoid "not fullscreen" warnings from vrmonitor
@@ -68,7 +71,6 @@ void MeganeX8KShim::PosTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitEr
 	
 	
 	// vr::VRServerDriverHost()->SetRecommendedRenderTargetSize(unObjectId, 5000, 5000);
-	distortionProfileConstructor.distortionSettings.resolution = 3552;
 	
 	distortionProfileConstructor.distortionSettings.noneDistortionFovHorizontal = 95;
 	distortionProfileConstructor.distortionSettings.noneDistortionFovVertical = 95;
@@ -76,72 +78,46 @@ void MeganeX8KShim::PosTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitEr
 	// start collection of the context so we can send events later
 	deviceProvider->SendContextCollectionEvents(unObjectId);
 	
-	if(!testThread.joinable()){
-		testThread = std::thread(&MeganeX8KShim::TestThread, this);
+	if(testTimer == 0){
+		testTimer = deviceProvider->scheduler.RunEvery("MeganeX8KShim::TestTimer", 5.0, [this](){
+			TestTimer();
+		});
 	}
 	
-	UpdateSettings();
+	// the distortion profile is built on a worker while activation continues
+	// EnsureInitialDistortionProfile waits for it once the compositor first needs it
+	appliedConfigGeneration = driverConfigGeneration;
+	UpdateSettings(WorkerPriorityLatencyCritical);
 	
+	driverStartupTimeline.Mark("ActivateDone");
 	returnValue = vr::VRInitError_None;
 }
 void MeganeX8KShim::PosTrackedDeviceDeactivate(){
 	isActive = false;
+	deviceProvider->scheduler.CancelTimer(testTimer);
+	testTimer = 0;
+	driverFlightRecorder.Record(FlightRecorderDeviceDeactivate, "MeganeX8K");
+	deviceProvider->scheduler.CancelTimer(renderTargetTimer);
+	renderTargetTimer = 0;
+	// UpdateSettings opens it again on activation so only profiles pushed after that are picked up
+	distortionMailbox.Close();
 	DriverLog("PosTrackedDeviceDeactivate");
 }
 
 // defines the fov of the input image
 bool MeganeX8KShim::PreDisplayComponentGetProjectionRaw(vr::EVREye &eEye, float *&pfLeft, float *&pfRight, float *&pfBottom, float *&pfTop){
+	EnsureInitialDistortionProfile();
 	distortionProfileConstructor.profile->GetProjectionRaw(eEye, pfLeft, pfRight, pfBottom, pfTop);
 	return false;
 }
 
 // run for each vertex of the distortion mesh and outputs the uv coordinates to sample for each color
 bool MeganeX8KShim::PreDisplayComponentComputeDistortion(vr::EVREye &eEye, float &fU, float &fV, vr::DistortionCoordinates_t &coordinates){
-	// change range to -1 to 1
-	fU = fU * 2.0f - 1.0f;
-	fV = fV * 2.0f - 1.0f;
-	if(eEye == vr::Eye_Left){
-		float tmp = fU;
-		fU = -fV;
-		fV = tmp;
-	}else{
-		float tmp = fU;
-		fU = fV;
-		fV = -tmp;
+	if(!driverStartupTimeline.IsFinished()){
+		EnsureInitialDistortionProfile();
+		driverStartupTimeline.Finish("FirstComputeDistortion");
 	}
-	float redV = fV;
-	float greenV = fV;
-	
-	// apply sub pixel offsets for super sampling
-	float subpixelOffset = (float)(1.0 / 3.0 / 3552.0);
-	// if(testToggle){
-	if(eEye == vr::Eye_Left){
-		redV -= subpixelOffset;
-		greenV += subpixelOffset;
-	}else{
-		redV += subpixelOffset;
-		greenV -= subpixelOffset;
-	}
-	// }
-	
-	// apply distortion profile to each color channel
-	Point2D distortionRed = distortionProfileConstructor.profile->ComputeDistortion(eEye, ColorChannelRed, fU, redV);
-	Point2D distortionGreen = distortionProfileConstructor.profile->ComputeDistortion(eEye, ColorChannelGreen, fU, greenV);
-	Point2D distortionBlue = distortionProfileConstructor.profile->ComputeDistortion(eEye, ColorChannelBlue, fU, fV);
-	
-	coordinates.rfRed[0] = distortionRed.x;
-	coordinates.rfRed[1] = distortionRed.y;
-	coordinates.rfGreen[0] = distortionGreen.x;
-	coordinates.rfGreen[1] = distortionGreen.y;
-	coordinates.rfBlue[0] = distortionBlue.x;
-	coordinates.rfBlue[1] = distortionBlue.y;
-	// change range to 0 to 1
-	coordinates.rfRed[0] = coordinates.rfRed[0] * 0.5f + 0.5f;
-	coordinates.rfRed[1] = coordinates.rfRed[1] * 0.5f + 0.5f;
-	coordinates.rfGreen[0] = coordinates.rfGreen[0] * 0.5f + 0.5f;
-	coordinates.rfGreen[1] = coordinates.rfGreen[1] * 0.5f + 0.5f;
-	coordinates.rfBlue[0] = coordinates.rfBlue[0] * 0.5f + 0.5f;
-	coordinates.rfBlue[1] = coordinates.rfBlue[1] * 0.5f + 0.5f;
+	ComputeMeganeX8KDistortion(distortionProfileConstructor.profile, eEye, fU, fV, MeganeX8KSubpixelOffset(panelMode.eyeSize), coordinates);
 	return false;
 }
 
@@ -162,53 +138,121 @@ bool MeganeX8KShim::PreDisplayComponentGetWindowBounds(int32_t *&pnX, int32_t *&
 	// *pnWidth = 2160;
 	// *pnHeight = 1200;
 	// applies to direct mode as well
-	*pnWidth = 7104;
-	*pnHeight = 3840;
-	// *pnWidth = 5328;
-	// *pnHeight = 2880;
+	*pnWidth = panelMode.windowWidth;
+	*pnHeight = panelMode.windowHeight;
 	return false;
 }
 
 // define where each eye is drawn onto the output screen
 bool MeganeX8KShim::PreDisplayComponentGetEyeOutputViewport(vr::EVREye &eEye, uint32_t *&pnX, uint32_t *&pnY, uint32_t *&pnWidth, uint32_t *&pnHeight){
-	if(eEye == vr::Eye_Left){
-		*pnX = 0;
-		// *pnY = 0;
-		*pnY = (3840 - 3552) / 2;
-		*pnWidth = 3552;
-		// *pnHeight = 3840;
-		*pnHeight = 3552;
-	}else{
-		*pnX = 3552;
-		// *pnY = 0;
-		*pnY = (3840 - 3552) / 2;
-		*pnWidth = 3552;
-		// *pnHeight = 3840;
-		*pnHeight = 3552;
-	}
-	// if(eEye == vr::Eye_Left){
-	// 	*pnX = 0;
-	// 	*pnY = (5328 - 2880) / 2;;
-	// 	*pnWidth = 2880;
-	// 	*pnHeight = 2880;
-	// }else{
-	// 	*pnX = 2880;
-	// 	*pnY = (5328 - 2880) / 2;;
-	// 	*pnWidth = 2880;
-	// 	*pnHeight = 2880;
-	// }
+	// each eye is a square in the vertical center of its half of the window
+	*pnX = eEye == vr::Eye_Left ? 0 : panelMode.windowWidth / 2;
+	*pnY = (panelMode.windowHeight - panelMode.eyeSize) / 2;
+	*pnWidth = panelMode.eyeSize;
+	*pnHeight = panelMode.eyeSize;
 	return false;
 };
 
 // this is the 100% resolution in steamvr settings
 bool MeganeX8KShim::PreDisplayComponentGetRecommendedRenderTargetSize(uint32_t* &pnWidth, uint32_t* &pnHeight){
-	*pnWidth = 3552;
-	*pnHeight = 3552;
-	// nWidth = 2880;
-	// nHeight = 2880;
+	*pnWidth = (uint32_t)(panelMode.eyeSize * renderTargetScale);
+	*pnHeight = (uint32_t)(panelMode.eyeSize * renderTargetScale);
 	return false;
 }
 
+void MeganeX8KShim::SetRenderTargetScale(double scale){
+	if(scale == renderTargetScale){
+		return;
+	}
+	renderTargetScale = scale;
+	uint32_t size = (uint32_t)(panelMode.eyeSize * renderTargetScale);
+	DriverLog("Recommended render target size changed to %ux%u", size, size);
+	vr::VRServerDriverHost()->SetRecommendedRenderTargetSize(0, size, size);
+}
+
+void MeganeX8KShim::UpdateAdaptiveRenderTarget(bool applicationChanged){
+	if(!driverConfig.adaptiveRenderTarget.enable){
+		if(renderTargetTimer != 0){
+			deviceProvider->scheduler.CancelTimer(renderTargetTimer);
+			renderTargetTimer = 0;
+			frameTimingSource = nullptr;
+		}
+		SetRenderTargetScale(appRenderTargetScale);
+		return;
+	}
+	renderTargetController.minScale = driverConfig.adaptiveRenderTarget.minScale;
+	renderTargetController.maxScale = std::max(driverConfig.adaptiveRenderTarget.minScale, driverConfig.adaptiveRenderTarget.maxScale);
+	renderTargetController.targetLoad = driverConfig.adaptiveRenderTarget.targetLoad;
+	renderTargetController.hysteresis = driverConfig.adaptiveRenderTarget.hysteresis;
+	
+	if(frameTimingSource == nullptr || frameTimingFile != driverConfig.adaptiveRenderTarget.timingFile){
+		frameTimingFile = driverConfig.adaptiveRenderTarget.timingFile;
+		if(frameTimingFile.empty()){
+			frameTimingSource = std::make_unique<CompositorFrameTimingSource>();
+		}else{
+			DriverLog("Reading frame timings from %s", frameTimingFile.c_str());
+			frameTimingSource = std::make_unique<FileFrameTimingSource>(frameTimingFile);
+		}
+		applicationChanged = true;
+	}
+	if(renderTargetTimer == 0){
+		// frequent enough that the compositor history covers every frame in between
+		renderTargetTimer = deviceProvider->scheduler.RunEvery("MeganeX8KShim::RunRenderTargetController", 0.1, [this](){
+			RunRenderTargetController();
+		});
+		applicationChanged = true;
+	}
+	// timings of another application say nothing about this one
+	if(applicationChanged){
+		renderTargetController.Reset(1.0);
+	}
+	SetRenderTargetScale(appRenderTargetScale * renderTargetController.GetScale());
+}
+
+void MeganeX8KShim::RunRenderTargetController(){
+	if(frameTimingSource == nullptr){
+		return;
+	}
+	frameTimingSamples.clear();
+	if(frameTimingSource->Poll(frameTimingSamples) == 0){
+		return;
+	}
+	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer(0);
+	float frequency = vr::VRProperties()->GetFloatProperty(container, vr::Prop_DisplayFrequency_Float);
+	double frameBudgetMs = 1000.0 / (frequency > 0 ? frequency : 90.0f);
+	bool changed = false;
+	for(const FrameTimingSample& sample : frameTimingSamples){
+		changed |= renderTargetController.AddSample(sample, frameBudgetMs);
+	}
+	if(changed){
+		DriverLog("Gpu load is %.0f%% of the frame time, adaptive render target scale is now %.2f", renderTargetController.GetLastLoad() * 100.0, renderTargetController.GetScale());
+		SetRenderTargetScale(appRenderTargetScale * renderTargetController.GetScale());
+	}
+}
+
+void MeganeX8KShim::ApplyPanelMode(){
+	if(!IsMeganeX8KPanelMode(driverConfig.meganeX8K.panelMode)){
+		DriverLog("Unknown panel mode %s, using %s", driverConfig.meganeX8K.panelMode.c_str(), meganeX8KPanelModes[0].name);
+	}
+	panelMode = FindMeganeX8KPanelMode(driverConfig.meganeX8K.panelMode);
+	DriverLog("Using panel mode %s with %ux%u eyes", panelMode.name, panelMode.eyeSize, panelMode.eyeSize);
+	
+	// profiles are built for the resolution of one eye
+	distortionProfileConstructor.distortionSettings.resolution = (float)panelMode.eyeSize;
+	
+	// every panel mode has square eyes and the profiles cover the whole square, so every pixel of the render target is shown
+	// the hidden area meshes are left empty for all modes, a mode with eyes that are not square would need its own meshes here
+	vr::HmdVector2_t mesh[1];
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_Standard, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_Standard, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_Inverse, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_Inverse, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_LineLoop, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_LineLoop, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Left, vr::k_eHiddenAreaMesh_Max, mesh, 0);
+	vr::VRHiddenArea()->SetHiddenArea(vr::Eye_Right, vr::k_eHiddenAreaMesh_Max, mesh, 0);
+}
+
 // set ipd and adjust eye to head transform accordingly. ipd is in meters.
 void MeganeX8KShim::SetIPD(float ipd){
 	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer(0);
@@ -236,19 +280,104 @@ void MeganeX8KShim::RunFrame(){
 	// vr::VRProperties()->SetVec3Property(container, vr::Prop_DisplayColorMultLeft_Vector3, {brightness, brightness, brightness});
 	// vr::VRProperties()->SetVec3Property(container, vr::Prop_DisplayColorMultRight_Vector3, {brightness, brightness, brightness});
 	
-	if(driverConfig.hasBeenUpdated){
+	uint64_t configGeneration = driverConfigGeneration;
+	if(configGeneration != appliedConfigGeneration){
+		appliedConfigGeneration = configGeneration;
 		UpdateSettings();
 	}
+	DistortionProfileConfig mailboxConfig;
+	if(distortionMailbox.Poll(mailboxConfig)){
+		DriverLog("Received distortion profile %s from the distortion mailbox", mailboxConfig.name.c_str());
+		distortionProfileConstructor.LoadDistortionProfileAsync(mailboxConfig, WorkerPriorityLatencyCritical);
+	}
+	ApplyPendingDistortionProfile();
+	distortionProfileConstructor.ReleaseRetiredProfiles();
+}
+
+size_t MeganeX8KShim::EnterStandby(){
+	return distortionProfileConstructor.ReleaseCaches();
+}
+
+void MeganeX8KShim::LeaveStandby(){
+	// restart a profile build that standby cancelled, this does nothing if the current profile is up to date
+	distortionProfileConstructor.LoadDistortionProfileAsync(activeDistortionProfile, WorkerPriorityLatencyCritical);
+	// rebuild the caches of the application profiles so switching to them stays instant
+	PrebuildAppProfiles();
 }
 
-void MeganeX8KShim::UpdateSettings(){
+void MeganeX8KShim::PrebuildAppProfiles(){
+	std::vector<std::string> names = {driverConfig.meganeX8K.distortionProfile};
+	for(auto& appOverride : driverConfig.appOverrides){
+		if(!appOverride.second.distortionProfile.empty()){
+			names.push_back(appOverride.second.distortionProfile);
+		}
+	}
+	distortionProfileConstructor.PrebuildProfiles(names);
+}
+
+void MeganeX8KShim::UpdateSettings(WorkerPriority profilePriority){
+	SetIPD((driverConfig.meganeX8K.ipd + driverConfig.meganeX8K.ipdOffset) / 1000.0f);
+	
+	ApplyAppOverride(profilePriority);
+	PrebuildAppProfiles();
+	
+	if(driverConfig.enableDistortionMailbox && !distortionMailbox.IsOpen()){
+		distortionMailbox.Open();
+	}else if(!driverConfig.enableDistortionMailbox && distortionMailbox.IsOpen()){
+		distortionMailbox.Close();
+	}
+}
+
+void MeganeX8KShim::ApplyAppOverride(WorkerPriority profilePriority){
 	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer(0);
 	
-	SetIPD((driverConfig.meganeX8K.ipd + driverConfig.meganeX8K.ipdOffset) / 1000.0f);
+	// settings of the scene application take priority over the headset settings
+	std::string distortionProfile = driverConfig.meganeX8K.distortionProfile;
+	double blackLevel = driverConfig.meganeX8K.blackLevel;
+	double scale = 1.0;
+	auto appOverride = driverConfig.appOverrides.find(deviceProvider->sceneApplication);
+	if(appOverride != driverConfig.appOverrides.end()){
+		if(!appOverride->second.distortionProfile.empty()){
+			distortionProfile = appOverride->second.distortionProfile;
+		}
+		if(appOverride->second.blackLevel >= 0){
+			blackLevel = appOverride->second.blackLevel;
+		}
+		if(appOverride->second.renderTargetScale > 0){
+			scale = appOverride->second.renderTargetScale;
+		}
+	}
 	
-	vr::VRProperties()->SetFloatProperty(container, vr::Prop_DisplayGCBlackClamp_Float, (float)driverConfig.meganeX8K.blackLevel);
+	vr::VRProperties()->SetFloatProperty(container, vr::Prop_DisplayGCBlackClamp_Float, (float)blackLevel);
+	bool applicationChanged = deviceProvider->sceneApplication != renderTargetApplication;
+	renderTargetApplication = deviceProvider->sceneApplication;
+	appRenderTargetScale = scale;
+	UpdateAdaptiveRenderTarget(applicationChanged);
 	
-	if(distortionProfileConstructor.LoadDistortionProfile(driverConfig.meganeX8K.distortionProfile)){
+	// build the profile on a worker, it is applied in RunFrame once ready
+	activeDistortionProfile = distortionProfile;
+	distortionProfileConstructor.LoadDistortionProfileAsync(activeDistortionProfile, profilePriority);
+}
+
+void MeganeX8KShim::SceneApplicationChanged(){
+	// the new application is starting so its profile is needed right away, it is usually prebuilt and taken from the cache
+	ApplyAppOverride(WorkerPriorityLatencyCritical);
+}
+
+void MeganeX8KShim::EnsureInitialDistortionProfile(){
+	if(initialProfileApplied){
+		return;
+	}
+	// the compositor is asking for the distortion right now so there is no need to signal a change
+	distortionProfileConstructor.WaitForPendingProfile();
+	distortionProfileConstructor.ApplyPendingProfile();
+	initialProfileApplied = true;
+	driverStartupTimeline.Mark("DistortionProfileReady");
+}
+
+void MeganeX8KShim::ApplyPendingDistortionProfile(){
+	if(distortionProfileConstructor.ApplyPendingProfile()){
+		initialProfileApplied = true;
 		// it has changed so signal the compositor to regenerate the distortion mesh
 		deviceProvider->SendVendorEvent(0, vr::VREvent_LensDistortionChanged, {}, 0);
 		// also update fov
@@ -261,26 +390,22 @@ void MeganeX8KShim::UpdateSettings(){
 }
 
 
-// a thread that is run every 5 seconds to test things with
-void MeganeX8KShim::TestThread(){
-	while (isActive){
-		testToggle = !testToggle;
-		
-		// DriverLog("TestToggle: %d\n", testToggle);
-		
-		
-		// uncomment this to regenerate the distortion mesh which will cause stutters
-		// deviceProvider->SendVendorEvent(0, vr::VREvent_LensDistortionChanged, {}, 0);
-		
-		vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer(0);
-		
-		
-		// vr::VRProperties()->SetFloatProperty( container, vr::Prop_DisplayGCBlackClamp_Float, testToggle ? 0.00f : 0.02f);
-		
-		// float brightness = std::sin(now) * 0.5 + 0.5;
-		// vr::VRProperties()->SetVec3Property(container, vr::Prop_DisplayColorMultLeft_Vector3, {brightness, brightness, brightness});
-		// vr::VRProperties()->SetVec3Property(container, vr::Prop_DisplayColorMultRight_Vector3, {brightness, brightness, brightness});
-		
-		std::this_thread::sleep_for(std::chrono::milliseconds(5000));
-	}
+// a timer that is run every 5 seconds on the main loop to test things with
+void MeganeX8KShim::TestTimer(){
+	testToggle = !testToggle;
+	
+	// DriverLog("TestToggle: %d\n", testToggle);
+	
+	
+	// uncomment this to regenerate the distortion mesh which will cause stutters
+	// deviceProvider->SendVendorEvent(0, vr::VREvent_LensDistortionChanged, {}, 0);
+	
+	vr::PropertyContainerHandle_t container = vr::VRProperties()->TrackedDeviceToPropertyContainer(0);
+	
+	
+	// vr::VRProperties()->SetFloatProperty( container, vr::Prop_DisplayGCBlackClamp_Float, testToggle ? 0.00f : 0.02f);
+	
+	// float brightness = std::sin(now) * 0.5 + 0.5;
+	// vr::VRProperties()->SetVec3Property(container, vr::Prop_DisplayColorMultLeft_Vector3, {brightness, brightness, brightness});
+	// vr::VRProperties()->SetVec3Property(container, vr::Prop_DisplayColorMultRight_Vector3, {brightness, brightness, brightness});
 }
\ No newline at end of file
@@ -3,9 +3,14 @@
 #include "../Driver/DriverLog.h"
 
 #include "../Distortion/DistortionProfileConstructor.h"
+#include "../Distortion/DistortionMailbox.h"
+#include "../Driver/RenderTargetController.h"
+#include "../Driver/FrameTimingSource.h"
+#include "MeganeX8KPanelModes.h"
 
-#include <thread>
 #include <cmath>
+#include <atomic>
+#include <memory>
 
 
 class MeganeX8KShim : public ShimDefinition{
@@ -13,12 +18,41 @@ public:
 	CustomHeadsetDeviceProvider* deviceProvider;
 	
 	DistortionProfileConstructor distortionProfileConstructor;
+	// profiles pushed live by calibration tools, open while enableDistortionMailbox is set
+	DistortionMailbox distortionMailbox;
 	
-	// test thread that toggles testToggle every 5 seconds to test things
+	// test timer that toggles testToggle every 5 seconds to test things
 	bool testToggle = false;
 	bool isActive = false;
-	std::thread testThread;
+	TaskScheduler::TaskId testTimer = 0;
 	
+	// driverConfigGeneration last applied by UpdateSettings
+	uint64_t appliedConfigGeneration = 0;
+	
+	// panel mode selected on activation, everything that depends on the resolution of the panels is derived from this
+	MeganeX8KPanelMode panelMode = meganeX8KPanelModes[0];
+	
+	// distortion profile in use after applying the overrides of the scene application
+	std::string activeDistortionProfile = "";
+	// multiplier of the recommended render target size from the overrides of the scene application
+	double appRenderTargetScale = 1.0;
+	// multiplier of the recommended render target size currently in use, including the adaptive scale
+	double renderTargetScale = 1.0;
+	
+	// adaptive render target size, running while adaptiveRenderTarget is enabled
+	RenderTargetController renderTargetController;
+	std::unique_ptr<FrameTimingSource> frameTimingSource;
+	// timing file the source was created for, empty for the compositor
+	std::string frameTimingFile = "";
+	TaskScheduler::TaskId renderTargetTimer = 0;
+	std::vector<FrameTimingSample> frameTimingSamples;
+	// scene application the controller was last reset for
+	std::string renderTargetApplication = "";
+	
+	// set once the first distortion profile has been applied
+	std::atomic<bool> initialProfileApplied = false;
+	
+	virtual bool PreTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitError &returnValue) override;
 	virtual void PosTrackedDeviceActivate(uint32_t &unObjectId, vr::EVRInitError &returnValue) override;
 	virtual void PosTrackedDeviceDeactivate() override;
 	virtual bool PreDisplayComponentGetProjectionRaw(vr::EVREye &eEye, float *&pfLeft, float *&pfRight, float *&pfBottom, float *&pfTop) override;
@@ -30,10 +64,34 @@ public:
 	virtual bool PreDisplayComponentGetRecommendedRenderTargetSize(uint32_t* &pnWidth, uint32_t* &pnHeight) override;
 	
 	void SetIPD(float ipd);
+	// select the panel mode from the config and apply the settings that depend on it
+	void ApplyPanelMode();
 	
 	virtual void RunFrame() override;
 	
-	void UpdateSettings();
+	virtual size_t EnterStandby() override;
+	virtual void LeaveStandby() override;
+	
+	// change the recommended render target size, only applications that query it afterwards will use it
+	void SetRenderTargetScale(double scale);
+	// apply the adaptiveRenderTarget config, starting or stopping the controller
+	void UpdateAdaptiveRenderTarget(bool applicationChanged);
+	// feed new frame timings to the controller and apply its scale
+	void RunRenderTargetController();
+	
+	// build the profiles of every application override in the background so switching to them is instant
+	void PrebuildAppProfiles();
+	
+	// apply the config, profilePriority is the worker priority for building the distortion profile
+	void UpdateSettings(WorkerPriority profilePriority = WorkerPriorityNormal);
+	// resolve the overrides of the scene application and start building its distortion profile
+	void ApplyAppOverride(WorkerPriority profilePriority);
+	virtual void SceneApplicationChanged() override;
+	
+	// switch to a distortion profile that has finished building and notify the compositor
+	void ApplyPendingDistortionProfile();
+	// wait for the profile started during activation if it has not been applied yet
+	void EnsureInitialDistortionProfile();
 	
-	void TestThread();
+	void TestTimer();
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "MeganeX8KDistortion.h"
+#include <vector>
+
+
+void ComputeMeganeX8KDistortion(DistortionProfile* profile, vr::EVREye eEye, float fU, float fV, float subpixelOffset, vr::DistortionCoordinates_t &coordinates){
+	// change range to -1 to 1
+	fU = fU * 2.0f - 1.0f;
+	fV = fV * 2.0f - 1.0f;
+	if(eEye == vr::Eye_Left){
+		float tmp = fU;
+		fU = -fV;
+		fV = tmp;
+	}else{
+		float tmp = fU;
+		fU = fV;
+		fV = -tmp;
+	}
+	float redV = fV;
+	float greenV = fV;
+
+	// apply sub pixel offsets for super sampling
+	if(eEye == vr::Eye_Left){
+		redV -= subpixelOffset;
+		greenV += subpixelOffset;
+	}else{
+		redV += subpixelOffset;
+		greenV -= subpixelOffset;
+	}
+
+	// apply distortion profile to each color channel
+	Point2D distortionRed = profile->ComputeDistortion(eEye, ColorChannelRed, fU, redV);
+	Point2D distortionGreen = profile->ComputeDistortion(eEye, ColorChannelGreen, fU, greenV);
+	Point2D distortionBlue = profile->ComputeDistortion(eEye, ColorChannelBlue, fU, fV);
+
+	// change range to 0 to 1
+	coordinates.rfRed[0] = distortionRed.x * 0.5f + 0.5f;
+	coordinates.rfRed[1] = distortionRed.y * 0.5f + 0.5f;
+	coordinates.rfGreen[0] = distortionGreen.x * 0.5f + 0.5f;
+	coordinates.rfGreen[1] = distortionGreen.y * 0.5f + 0.5f;
+	coordinates.rfBlue[0] = distortionBlue.x * 0.5f + 0.5f;
+	coordinates.rfBlue[1] = distortionBlue.y * 0.5f + 0.5f;
+}
+
+void ComputeMeganeX8KDistortionBatch(DistortionProfile* profile, vr::EVREye eEye, const float* fU, const float* fV, float subpixelOffset, float* const outU[3], float* const outV[3], uint32_t count){
+	std::vector<float> panelU(count);
+	std::vector<float> panelV(count);
+	std::vector<float> redV(count);
+	std::vector<float> greenV(count);
+	// the same rotation and sub pixel offsets as ComputeMeganeX8KDistortion
+	float redOffset = eEye == vr::Eye_Left ? -subpixelOffset : subpixelOffset;
+	for(uint32_t i = 0; i < count; i++){
+		float u = fU[i] * 2.0f - 1.0f;
+		float v = fV[i] * 2.0f - 1.0f;
+		if(eEye == vr::Eye_Left){
+			panelU[i] = -v;
+			panelV[i] = u;
+		}else{
+			panelU[i] = v;
+			panelV[i] = -u;
+		}
+		redV[i] = panelV[i] + redOffset;
+		greenV[i] = panelV[i] - redOffset;
+	}
+	
+	profile->ComputeDistortionBatch(eEye, ColorChannelRed, panelU.data(), redV.data(), outU[ColorChannelRed], outV[ColorChannelRed], count);
+	profile->ComputeDistortionBatch(eEye, ColorChannelGreen, panelU.data(), greenV.data(), outU[ColorChannelGreen], outV[ColorChannelGreen], count);
+	profile->ComputeDistortionBatch(eEye, ColorChannelBlue, panelU.data(), panelV.data(), outU[ColorChannelBlue], outV[ColorChannelBlue], count);
+	
+	// change range to 0 to 1
+	for(int channel = 0; channel < 3; channel++){
+		for(uint32_t i = 0; i < count; i++){
+			outU[channel][i] = outU[channel][i] * 0.5f + 0.5f;
+			outV[channel][i] = outV[channel][i] * 0.5f + 0.5f;
+		}
+	}
+}
+
+bool ComputeMeganeX8KInverseDistortion(DistortionProfile* profile, vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, float subpixelOffset, Point2D &result){
+	Point2D panel;
+	if(!profile->ComputeInverseDistortion(eEye, colorChannel, fU * 2.0f - 1.0f, fV * 2.0f - 1.0f, panel)){
+		return false;
+	}
+	
+	// undo the sub pixel offsets
+	if(colorChannel == ColorChannelRed){
+		panel.y += eEye == vr::Eye_Left ? subpixelOffset : -subpixelOffset;
+	}else if(colorChannel == ColorChannelGreen){
+		panel.y -= eEye == vr::Eye_Left ? subpixelOffset : -subpixelOffset;
+	}
+	
+	// undo the rotation of the panels
+	float panelU, panelV;
+	if(eEye == vr::Eye_Left){
+		panelU = panel.y;
+		panelV = -panel.x;
+	}else{
+		panelU = -panel.y;
+		panelV = panel.x;
+	}
+	
+	// change range to 0 to 1
+	result.x = panelU * 0.5f + 0.5f;
+	result.y = panelV * 0.5f + 0.5f;
+	return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "../Distortion/DistortionProfile.h"
+
+
+// offset of the red and green subpixels from the blue subpixel in -1 to 1 units for a panel resolution
+inline float MeganeX8KSubpixelOffset(int panelResolution){
+	return (float)(1.0 / 3.0 / panelResolution);
+}
+
+// compute the uv coordinates to sample for each color the same way MeganeX8KShim returns them from ComputeDistortion
+// this applies the per eye rotation of the panels and the sub pixel offsets before the profile
+// fU and fV are from 0 to 1 within the eye viewport and the coordinates are from 0 to 1 within the eye input image
+// this is shared with the tools so previews match what the compositor receives
+void ComputeMeganeX8KDistortion(DistortionProfile* profile, vr::EVREye eEye, float fU, float fV, float subpixelOffset, vr::DistortionCoordinates_t &coordinates);
+
+// ComputeMeganeX8KDistortion for count points at once using the batch evaluation of the profile
+// the coordinates of each color are written to outU[colorChannel] and outV[colorChannel] which each have room for count values
+void ComputeMeganeX8KDistortionBatch(DistortionProfile* profile, vr::EVREye eEye, const float* fU, const float* fV, float subpixelOffset, float* const outU[3], float* const outV[3], uint32_t count);
+
+// the inverse of ComputeMeganeX8KDistortion for one color, maps a point from 0 to 1 in the eye input image to 0 to 1 in the eye viewport
+// returns false if the profile does not support an inverse
+bool ComputeMeganeX8KInverseDistortion(DistortionProfile* profile, vr::EVREye eEye, ColorChannel colorChannel, float fU, float fV, float subpixelOffset, Point2D &result);
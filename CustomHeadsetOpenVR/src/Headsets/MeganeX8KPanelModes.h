@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+
+// a resolution the MeganeX superlight 8K panels can be driven at
+// the window covers both panels side by side and each eye uses a square in the vertical center of its half
+// the eyes must stay square since the hidden area meshes are left empty for every mode
+struct MeganeX8KPanelMode{
+	// name used for panelMode in the config
+	const char* name;
+	// size of the window covering both panels
+	uint32_t windowWidth;
+	uint32_t windowHeight;
+	// width and height of the square area of each eye, this is the resolution of the distortion
+	uint32_t eyeSize;
+};
+
+static const MeganeX8KPanelMode meganeX8KPanelModes[] = {
+	{"7104x3840", 7104, 3840, 3552},
+	// lower bandwidth mode for weaker render nodes
+	{"5328x2880", 5328, 2880, 2664},
+};
+
+// find a panel mode by name, falls back to the first mode if the name is unknown
+inline const MeganeX8KPanelMode& FindMeganeX8KPanelMode(const std::string& name){
+	for(const MeganeX8KPanelMode& mode : meganeX8KPanelModes){
+		if(name == mode.name){
+			return mode;
+		}
+	}
+	return meganeX8KPanelModes[0];
+}
+
+// check if a panel mode with this name exists
+inline bool IsMeganeX8KPanelMode(const std::string& name){
+	for(const MeganeX8KPanelMode& mode : meganeX8KPanelModes){
+		if(name == mode.name){
+			return true;
+		}
+	}
+	return false;
+}
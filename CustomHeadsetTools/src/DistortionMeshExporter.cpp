@@ -0,0 +1,173 @@
+#include "DistortionMeshExporter.h"
+#include "../../CustomHeadsetOpenVR/src/Headsets/MeganeX8KDistortion.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/WorkerPool.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/DriverLog.h"
+#include <algorithm>
+#include <vector>
+
+
+int DistortionMeshExporter::ValuesPerPoint(){
+	return includeInverse ? 12 : 6;
+}
+
+void DistortionMeshExporter::EvaluateRows(vr::EVREye eye, int firstRow, int lastRow, float* values){
+	int valuesPerPoint = ValuesPerPoint();
+	Point2D inverse;
+	// each row is evaluated in one batch so profiles with a batch evaluation can use it
+	std::vector<float> rowU(gridWidth);
+	std::vector<float> rowV(gridWidth);
+	std::vector<float> distortions[6];
+	for(std::vector<float>& distortion : distortions){
+		distortion.resize(gridWidth);
+	}
+	float* outU[3] = {distortions[0].data(), distortions[2].data(), distortions[4].data()};
+	float* outV[3] = {distortions[1].data(), distortions[3].data(), distortions[5].data()};
+	for(int x = 0; x < gridWidth; x++){
+		// the grid includes the edges like the mesh the compositor builds
+		rowU[x] = gridWidth > 1 ? (float)x / (gridWidth - 1) : 0.5f;
+	}
+	for(int y = firstRow; y < lastRow; y++){
+		float fV = gridHeight > 1 ? (float)y / (gridHeight - 1) : 0.5f;
+		std::fill(rowV.begin(), rowV.end(), fV);
+		ComputeMeganeX8KDistortionBatch(profile, eye, rowU.data(), rowV.data(), subpixelOffset, outU, outV, (uint32_t)gridWidth);
+		for(int x = 0; x < gridWidth; x++){
+			float fU = rowU[x];
+			float* point = values + ((size_t)(y - firstRow) * gridWidth + x) * valuesPerPoint;
+			for(int value = 0; value < 6; value++){
+				point[value] = distortions[value][x];
+			}
+			if(includeInverse){
+				for(int channel = 0; channel < 3; channel++){
+					ComputeMeganeX8KInverseDistortion(profile, eye, (ColorChannel)channel, fU, fV, subpixelOffset, inverse);
+					point[6 + channel * 2] = inverse.x;
+					point[7 + channel * 2] = inverse.y;
+				}
+			}
+		}
+	}
+}
+
+void DistortionMeshExporter::PrepareProfile(){
+	// the profile builds its maps lazily so make sure that happens before workers share it
+	Point2D inverse;
+	if(includeInverse && !profile->ComputeInverseDistortion(vr::Eye_Left, ColorChannelGreen, 0, 0, inverse)){
+		DriverLog("The profile does not support an inverse, exporting without it");
+		includeInverse = false;
+	}
+	profile->ComputeDistortion(vr::Eye_Left, ColorChannelGreen, 0, 0);
+}
+
+template<typename WriteChunk>
+bool DistortionMeshExporter::StreamChunks(WriteChunk write){
+	int rowsPerChunk = std::max(1, chunkRows);
+	int valuesPerPoint = ValuesPerPoint();
+	std::vector<float> values((size_t)rowsPerChunk * gridWidth * valuesPerPoint);
+	for(vr::EVREye eye : {vr::Eye_Left, vr::Eye_Right}){
+		for(int firstRow = 0; firstRow < gridHeight; firstRow += rowsPerChunk){
+			int lastRow = std::min(firstRow + rowsPerChunk, gridHeight);
+			// split the chunk into a job for each few rows
+			std::vector<WorkerJobHandle> jobs;
+			for(int jobRow = firstRow; jobRow < lastRow; jobRow += 4){
+				int jobLastRow = std::min(jobRow + 4, lastRow);
+				float* jobValues = values.data() + (size_t)(jobRow - firstRow) * gridWidth * valuesPerPoint;
+				jobs.push_back(driverWorkerPool.Submit("DistortionMeshExporter::EvaluateRows", WorkerPriorityLatencyCritical, [this, eye, jobRow, jobLastRow, jobValues](WorkerJob& job){
+					EvaluateRows(eye, jobRow, jobLastRow, jobValues);
+				}));
+			}
+			for(WorkerJobHandle& job : jobs){
+				job->Wait();
+			}
+			if(!write(eye, firstRow, lastRow, (const float*)values.data())){
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool DistortionMeshExporter::ExportBinary(const std::string& path){
+	FILE* file = fopen(path.c_str(), "wb");
+	if(file == nullptr){
+		DriverLog("Could not write to %s", path.c_str());
+		return false;
+	}
+	PrepareProfile();
+	DistortionMeshHeader header = {distortionMeshMagic, distortionMeshVersion, (uint32_t)gridWidth, (uint32_t)gridHeight, includeInverse ? distortionMeshHasInverse : 0, subpixelOffset};
+	fwrite(&header, sizeof(header), 1, file);
+	int valuesPerPoint = ValuesPerPoint();
+	bool result = StreamChunks([&](vr::EVREye /*eye*/, int firstRow, int lastRow, const float* values){
+		size_t count = (size_t)(lastRow - firstRow) * gridWidth * valuesPerPoint;
+		return fwrite(values, sizeof(float), count, file) == count;
+	});
+	fclose(file);
+	return result;
+}
+
+bool DistortionMeshExporter::ExportCSV(const std::string& path){
+	FILE* file = fopen(path.c_str(), "w");
+	if(file == nullptr){
+		DriverLog("Could not write to %s", path.c_str());
+		return false;
+	}
+	PrepareProfile();
+	fprintf(file, "eye,x,y,redU,redV,greenU,greenV,blueU,blueV%s\n", includeInverse ? ",inverseRedU,inverseRedV,inverseGreenU,inverseGreenV,inverseBlueU,inverseBlueV" : "");
+	int valuesPerPoint = ValuesPerPoint();
+	bool result = StreamChunks([&](vr::EVREye eye, int firstRow, int lastRow, const float* values){
+		const char* eyeName = eye == vr::Eye_Left ? "left" : "right";
+		for(int y = firstRow; y < lastRow; y++){
+			for(int x = 0; x < gridWidth; x++){
+				const float* point = values + ((size_t)(y - firstRow) * gridWidth + x) * valuesPerPoint;
+				fprintf(file, "%s,%d,%d", eyeName, x, y);
+				for(int i = 0; i < valuesPerPoint; i++){
+					fprintf(file, ",%.7g", point[i]);
+				}
+				fprintf(file, "\n");
+			}
+		}
+		return ferror(file) == 0;
+	});
+	fclose(file);
+	return result;
+}
+
+bool DistortionMeshExporter::ExportOBJ(const std::string& path){
+	FILE* file = fopen(path.c_str(), "w");
+	if(file == nullptr){
+		DriverLog("Could not write to %s", path.c_str());
+		return false;
+	}
+	// the inverse is not part of the mesh
+	includeInverse = false;
+	PrepareProfile();
+	fprintf(file, "# distortion mesh, vertices are panel positions and texture coordinates are the green uv\n");
+	bool result = StreamChunks([&](vr::EVREye eye, int firstRow, int lastRow, const float* values){
+		if(firstRow == 0){
+			fprintf(file, "o %s\n", eye == vr::Eye_Left ? "left" : "right");
+		}
+		for(int y = firstRow; y < lastRow; y++){
+			for(int x = 0; x < gridWidth; x++){
+				const float* point = values + ((size_t)(y - firstRow) * gridWidth + x) * 6;
+				float fU = gridWidth > 1 ? (float)x / (gridWidth - 1) : 0.5f;
+				float fV = gridHeight > 1 ? (float)y / (gridHeight - 1) : 0.5f;
+				// place the right eye next to the left like on the panel and flip v so the mesh is upright
+				fprintf(file, "v %.7g %.7g 0\n", fU + (eye == vr::Eye_Right ? 1.0f : 0.0f), 1.0f - fV);
+				fprintf(file, "vt %.7g %.7g\n", point[2], 1.0f - point[3]);
+			}
+		}
+		if(lastRow < gridHeight){
+			return ferror(file) == 0;
+		}
+		// faces are written once all vertices of the eye are written, obj indices start at 1
+		size_t eyeOffset = (eye == vr::Eye_Right ? (size_t)gridWidth * gridHeight : 0) + 1;
+		for(int y = 0; y + 1 < gridHeight; y++){
+			for(int x = 0; x + 1 < gridWidth; x++){
+				size_t topLeft = eyeOffset + (size_t)y * gridWidth + x;
+				size_t bottomLeft = topLeft + gridWidth;
+				fprintf(file, "f %zu/%zu %zu/%zu %zu/%zu %zu/%zu\n", topLeft, topLeft, bottomLeft, bottomLeft, bottomLeft + 1, bottomLeft + 1, topLeft + 1, topLeft + 1);
+			}
+		}
+		return ferror(file) == 0;
+	});
+	fclose(file);
+	return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "../../CustomHeadsetOpenVR/src/Distortion/DistortionProfile.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+
+// header of the binary mesh format, followed by the grid points of the left eye and then the right eye
+// each grid point is row major and is 6 floats of red, green and blue uv from ComputeDistortion
+// followed by 6 more floats of red, green and blue panel uv from the inverse if flags has distortionMeshHasInverse
+// the inverse is evaluated with the grid point as the input image uv
+// all values are little endian
+#pragma pack(push, 4)
+struct DistortionMeshHeader{
+	// 'CHDX'
+	uint32_t magic;
+	uint32_t version;
+	uint32_t gridWidth;
+	uint32_t gridHeight;
+	uint32_t flags;
+	float subpixelOffset;
+};
+#pragma pack(pop)
+static const uint32_t distortionMeshMagic = 0x58444843;
+static const uint32_t distortionMeshVersion = 1;
+static const uint32_t distortionMeshHasInverse = 1;
+
+
+// Evaluates the distortion of both eyes on a grid and streams it to a file.
+// Rows are evaluated in chunks on the worker pool and written before the next chunk,
+// so memory stays the same no matter how dense the grid is.
+class DistortionMeshExporter{
+public:
+	DistortionProfile* profile = nullptr;
+	float subpixelOffset = 0;
+	int gridWidth = 256;
+	int gridHeight = 256;
+	// include the inverse mapping if the profile supports it
+	bool includeInverse = true;
+	// rows evaluated between each write
+	int chunkRows = 64;
+
+	// binary format described by DistortionMeshHeader
+	bool ExportBinary(const std::string& path);
+	// one line per grid point with a header line
+	bool ExportCSV(const std::string& path);
+	// a mesh for each eye with the panel position as the vertex and the green uv as the texture coordinate
+	bool ExportOBJ(const std::string& path);
+private:
+	// number of floats for each grid point
+	int ValuesPerPoint();
+	// evaluate rows of an eye into values which has room for ValuesPerPoint floats per grid point
+	void EvaluateRows(vr::EVREye eye, int firstRow, int lastRow, float* values);
+	// build the maps of the profile and check if the inverse is supported
+	void PrepareProfile();
+	// evaluate every chunk of both eyes in order and pass it to write
+	template<typename WriteChunk>
+	bool StreamChunks(WriteChunk write);
+};
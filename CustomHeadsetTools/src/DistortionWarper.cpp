@@ -0,0 +1,128 @@
+#include "DistortionWarper.h"
+#include "../../CustomHeadsetOpenVR/src/Headsets/MeganeX8KDistortion.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/WorkerPool.h"
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DISTORTION_WARPER_SSE2
+#endif
+
+
+// sample one channel of the image at count uv coordinates with bilinear filtering
+// coordinates outside of 0 to 1 are outside of the rendered fov and sample black
+static void SampleBilinear(const Image& image, int channel, const float* u, const float* v, float* out, int count){
+	const float* plane = image.channels[channel].data();
+	int width = image.width;
+	int height = image.height;
+	int i = 0;
+#ifdef DISTORTION_WARPER_SSE2
+	// four samples at a time, the texel fetches are scalar but the addressing and filtering are vectorized
+	const __m128 scaleX = _mm_set1_ps((float)width);
+	const __m128 scaleY = _mm_set1_ps((float)height);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 maxX = _mm_set1_ps((float)(width - 1));
+	const __m128 maxY = _mm_set1_ps((float)(height - 1));
+	alignas(16) int x0s[4];
+	alignas(16) int y0s[4];
+	alignas(16) float p00[4], p10[4], p01[4], p11[4];
+	for(; i + 4 <= count; i += 4){
+		__m128 sampleU = _mm_loadu_ps(u + i);
+		__m128 sampleV = _mm_loadu_ps(v + i);
+		__m128 inside = _mm_and_ps(
+			_mm_and_ps(_mm_cmpge_ps(sampleU, zero), _mm_cmple_ps(sampleU, one)),
+			_mm_and_ps(_mm_cmpge_ps(sampleV, zero), _mm_cmple_ps(sampleV, one))
+		);
+		// texel centers are at half texels, clamp to the edge texels
+		__m128 x = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(sampleU, scaleX), half), zero), maxX);
+		__m128 y = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(sampleV, scaleY), half), zero), maxY);
+		// x and y are positive so truncation is the floor
+		__m128i x0 = _mm_cvttps_epi32(x);
+		__m128i y0 = _mm_cvttps_epi32(y);
+		__m128 fractionX = _mm_sub_ps(x, _mm_cvtepi32_ps(x0));
+		__m128 fractionY = _mm_sub_ps(y, _mm_cvtepi32_ps(y0));
+		_mm_store_si128((__m128i*)x0s, x0);
+		_mm_store_si128((__m128i*)y0s, y0);
+		for(int j = 0; j < 4; j++){
+			int x1 = std::min(x0s[j] + 1, width - 1);
+			const float* row0 = plane + (size_t)y0s[j] * width;
+			const float* row1 = plane + (size_t)std::min(y0s[j] + 1, height - 1) * width;
+			p00[j] = row0[x0s[j]];
+			p10[j] = row0[x1];
+			p01[j] = row1[x0s[j]];
+			p11[j] = row1[x1];
+		}
+		__m128 top = _mm_add_ps(_mm_load_ps(p00), _mm_mul_ps(fractionX, _mm_sub_ps(_mm_load_ps(p10), _mm_load_ps(p00))));
+		__m128 bottom = _mm_add_ps(_mm_load_ps(p01), _mm_mul_ps(fractionX, _mm_sub_ps(_mm_load_ps(p11), _mm_load_ps(p01))));
+		__m128 result = _mm_add_ps(top, _mm_mul_ps(fractionY, _mm_sub_ps(bottom, top)));
+		_mm_storeu_ps(out + i, _mm_and_ps(result, inside));
+	}
+#endif
+	for(; i < count; i++){
+		if(u[i] < 0.0f || u[i] > 1.0f || v[i] < 0.0f || v[i] > 1.0f){
+			out[i] = 0.0f;
+			continue;
+		}
+		float x = std::min(std::max(u[i] * width - 0.5f, 0.0f), (float)(width - 1));
+		float y = std::min(std::max(v[i] * height - 0.5f, 0.0f), (float)(height - 1));
+		int x0 = (int)x;
+		int y0 = (int)y;
+		int x1 = std::min(x0 + 1, width - 1);
+		int y1 = std::min(y0 + 1, height - 1);
+		float fractionX = x - x0;
+		float fractionY = y - y0;
+		const float* row0 = plane + (size_t)y0 * width;
+		const float* row1 = plane + (size_t)y1 * width;
+		float top = row0[x0] + fractionX * (row0[x1] - row0[x0]);
+		float bottom = row1[x0] + fractionX * (row1[x1] - row1[x0]);
+		out[i] = top + fractionY * (bottom - top);
+	}
+}
+
+void DistortionWarper::WarpRows(const Image& input, Image& output, vr::EVREye eye, int firstRow, int lastRow){
+	int width = output.width;
+	// uv coordinates for a row stored by channel so each channel can be sampled in one pass
+	std::vector<float> u[3];
+	std::vector<float> v[3];
+	for(int channel = 0; channel < 3; channel++){
+		u[channel].resize(width);
+		v[channel].resize(width);
+	}
+	float* outU[3] = {u[0].data(), u[1].data(), u[2].data()};
+	float* outV[3] = {v[0].data(), v[1].data(), v[2].data()};
+	// the whole row is evaluated in one batch so profiles with a batch evaluation can use it
+	std::vector<float> rowU(width);
+	std::vector<float> rowV(width);
+	for(int x = 0; x < width; x++){
+		rowU[x] = (x + 0.5f) / width;
+	}
+	for(int y = firstRow; y < lastRow; y++){
+		std::fill(rowV.begin(), rowV.end(), (y + 0.5f) / output.height);
+		ComputeMeganeX8KDistortionBatch(profile, eye, rowU.data(), rowV.data(), subpixelOffset, outU, outV, (uint32_t)width);
+		for(int channel = 0; channel < 3; channel++){
+			SampleBilinear(input, channel, u[channel].data(), v[channel].data(), output.channels[channel].data() + (size_t)y * width, width);
+		}
+	}
+}
+
+void DistortionWarper::Warp(const Image& input, Image& output, vr::EVREye eye, int outputSize){
+	output.Resize(outputSize, outputSize);
+	// the profile builds its maps lazily so make sure that happens before workers share it
+	vr::DistortionCoordinates_t coordinates;
+	ComputeMeganeX8KDistortion(profile, eye, 0.5f, 0.5f, subpixelOffset, coordinates);
+
+	// bands of rows are small enough to balance between workers but large enough to keep overhead low
+	const int rowsPerJob = 32;
+	std::vector<WorkerJobHandle> jobs;
+	for(int firstRow = 0; firstRow < outputSize; firstRow += rowsPerJob){
+		int lastRow = std::min(firstRow + rowsPerJob, outputSize);
+		jobs.push_back(driverWorkerPool.Submit("DistortionWarper::WarpRows", WorkerPriorityLatencyCritical, [this, &input, &output, eye, firstRow, lastRow](WorkerJob& job){
+			WarpRows(input, output, eye, firstRow, lastRow);
+		}));
+	}
+	for(WorkerJobHandle& job : jobs){
+		job->Wait();
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "Image.h"
+#include "../../CustomHeadsetOpenVR/src/Distortion/DistortionProfile.h"
+
+
+// Warps an eye image onto the panel on the cpu the same way the compositor samples it with the distortion mesh.
+// Every output pixel is evaluated with ComputeMeganeX8KDistortion instead of interpolating a mesh,
+// so this is a reference for what the mesh approximates.
+class DistortionWarper{
+public:
+	DistortionProfile* profile = nullptr;
+	// offset between subpixels passed to ComputeMeganeX8KDistortion
+	float subpixelOffset = 0;
+
+	// warp input into a square output of outputSize for one eye
+	// rows are split between the workers of driverWorkerPool
+	void Warp(const Image& input, Image& output, vr::EVREye eye, int outputSize);
+private:
+	void WarpRows(const Image& input, Image& output, vr::EVREye eye, int firstRow, int lastRow);
+};
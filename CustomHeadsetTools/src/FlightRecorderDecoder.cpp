@@ -0,0 +1,77 @@
+#include "FlightRecorderDecoder.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/FlightRecorder.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/DriverLog.h"
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cstring>
+#include <cstdint>
+
+
+// local date and time of a record with microseconds
+static std::string FormatTime(int64_t unixMicroseconds){
+	time_t seconds = (time_t)(unixMicroseconds / 1000000);
+	char text[64] = {};
+	strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", localtime(&seconds));
+	char withMicroseconds[80] = {};
+	snprintf(withMicroseconds, sizeof(withMicroseconds), "%s.%06d", text, (int)(unixMicroseconds % 1000000));
+	return withMicroseconds;
+}
+
+bool DecodeFlightRecorder(const std::string& path, double seconds, FILE* output){
+	FILE* file = fopen(path.c_str(), "rb");
+	if(file == nullptr){
+		DriverLog("Could not open %s", path.c_str());
+		return false;
+	}
+	FlightRecorderHeader header = {};
+	if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != flightRecorderMagic){
+		DriverLog("%s is not a flight recorder file", path.c_str());
+		fclose(file);
+		return false;
+	}
+	if(header.version != flightRecorderVersion || header.recordSize != sizeof(FlightRecorderRecord) || header.recordCount == 0 || (header.recordCount & (header.recordCount - 1)) != 0){
+		DriverLog("%s was written with an unsupported layout, version %u record size %u", path.c_str(), header.version, header.recordSize);
+		fclose(file);
+		return false;
+	}
+	std::vector<FlightRecorderRecord> records(header.recordCount);
+	size_t count = fread(records.data(), sizeof(FlightRecorderRecord), records.size(), file);
+	fclose(file);
+	records.resize(count);
+	
+	// drop empty slots and records that were being written when the process stopped
+	std::vector<FlightRecorderRecord> complete;
+	for(size_t i = 0; i < records.size(); i++){
+		uint64_t sequence = records[i].sequence;
+		if(sequence != 0 && ((sequence - 1) & (header.recordCount - 1)) == i){
+			complete.push_back(records[i]);
+		}
+	}
+	std::sort(complete.begin(), complete.end(), [](const FlightRecorderRecord& a, const FlightRecorderRecord& b){
+		return a.sequence < b.sequence;
+	});
+	fprintf(output, "Flight recorder of process %u started %s, %zu records\n", header.processId, FormatTime(header.startTime).c_str(), complete.size());
+	if(complete.empty()){
+		return true;
+	}
+	
+	int64_t lastTime = complete.back().time;
+	int64_t firstTime = seconds > 0 ? lastTime - (int64_t)(seconds * 1000000.0) : INT64_MIN;
+	uint64_t previousSequence = 0;
+	for(const FlightRecorderRecord& record : complete){
+		if(record.time < firstTime){
+			previousSequence = record.sequence;
+			continue;
+		}
+		if(previousSequence != 0 && record.sequence != previousSequence + 1){
+			fprintf(output, "... %llu records missing\n", (unsigned long long)(record.sequence - previousSequence - 1));
+		}
+		previousSequence = record.sequence;
+		char text[sizeof(record.text) + 1] = {};
+		memcpy(text, record.text, sizeof(record.text));
+		// time relative to the newest record makes it easy to see what led up to a crash
+		fprintf(output, "%s %+10.3fs thread %5u %-24s %-40s %lld %lld\n", FormatTime(record.time).c_str(), (record.time - lastTime) / 1000000.0, record.threadId, FlightRecorderEventName(record.type), text, (long long)record.value0, (long long)record.value1);
+	}
+	return true;
+}
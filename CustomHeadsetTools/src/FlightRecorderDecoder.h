@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+#include <cstdio>
+
+
+// print the records of a flight recorder file from the last seconds before its newest record
+// seconds of 0 or less prints every record still in the ring
+// returns false if the file could not be read
+bool DecodeFlightRecorder(const std::string& path, double seconds, FILE* output);
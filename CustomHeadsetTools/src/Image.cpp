@@ -0,0 +1,103 @@
+#include "Image.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/DriverLog.h"
+#include <fstream>
+#include <algorithm>
+
+
+void Image::Resize(int newWidth, int newHeight){
+	width = newWidth;
+	height = newHeight;
+	for(int channel = 0; channel < 3; channel++){
+		channels[channel].assign((size_t)width * height, 0.0f);
+	}
+}
+
+// read the next number from a ppm header, skipping whitespace and comments
+static bool ReadHeaderValue(std::ifstream& file, int& value){
+	while(true){
+		int character = file.peek();
+		if(character == '#'){
+			std::string comment;
+			std::getline(file, comment);
+		}else if(character == ' ' || character == '\t' || character == '\r' || character == '\n'){
+			file.get();
+		}else{
+			break;
+		}
+	}
+	file >> value;
+	return !file.fail();
+}
+
+bool Image::LoadPPM(const std::string& path){
+	std::ifstream file(path, std::ios::binary);
+	if(!file.is_open()){
+		DriverLog("Could not open %s", path.c_str());
+		return false;
+	}
+	char magic[2] = {};
+	file.read(magic, 2);
+	bool binary = magic[0] == 'P' && magic[1] == '6';
+	bool ascii = magic[0] == 'P' && magic[1] == '3';
+	int fileWidth = 0, fileHeight = 0, maxValue = 0;
+	if((!binary && !ascii) || !ReadHeaderValue(file, fileWidth) || !ReadHeaderValue(file, fileHeight) || !ReadHeaderValue(file, maxValue)){
+		DriverLog("%s is not a P3 or P6 ppm file", path.c_str());
+		return false;
+	}
+	if(fileWidth <= 0 || fileHeight <= 0 || maxValue <= 0 || maxValue > 65535){
+		DriverLog("%s has an invalid size or max value", path.c_str());
+		return false;
+	}
+	Resize(fileWidth, fileHeight);
+	float scale = 1.0f / maxValue;
+	size_t pixelCount = (size_t)width * height;
+	if(binary){
+		// a single whitespace character separates the header from the data
+		file.get();
+		int bytesPerValue = maxValue > 255 ? 2 : 1;
+		std::vector<unsigned char> data(pixelCount * 3 * bytesPerValue);
+		file.read((char*)data.data(), data.size());
+		if((size_t)file.gcount() != data.size()){
+			DriverLog("%s is truncated", path.c_str());
+			return false;
+		}
+		for(size_t i = 0; i < pixelCount; i++){
+			for(int channel = 0; channel < 3; channel++){
+				size_t index = (i * 3 + channel) * bytesPerValue;
+				int value = bytesPerValue == 2 ? (data[index] << 8) | data[index + 1] : data[index];
+				channels[channel][i] = value * scale;
+			}
+		}
+	}else{
+		for(size_t i = 0; i < pixelCount; i++){
+			for(int channel = 0; channel < 3; channel++){
+				int value = 0;
+				if(!ReadHeaderValue(file, value)){
+					DriverLog("%s is truncated", path.c_str());
+					return false;
+				}
+				channels[channel][i] = value * scale;
+			}
+		}
+	}
+	return true;
+}
+
+bool Image::SavePPM(const std::string& path) const{
+	std::ofstream file(path, std::ios::binary);
+	if(!file.is_open()){
+		DriverLog("Could not write to %s", path.c_str());
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	size_t pixelCount = (size_t)width * height;
+	std::vector<unsigned char> data(pixelCount * 3);
+	for(size_t i = 0; i < pixelCount; i++){
+		for(int channel = 0; channel < 3; channel++){
+			float value = std::min(std::max(channels[channel][i], 0.0f), 1.0f);
+			data[i * 3 + channel] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+	}
+	file.write((const char*)data.data(), data.size());
+	return file.good();
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <vector>
+
+
+// an rgb image with each channel stored in its own plane of floats from 0 to 1
+// planes make it possible to resample one color at a time like the compositor does for each color
+class Image{
+public:
+	int width = 0;
+	int height = 0;
+	std::vector<float> channels[3];
+
+	void Resize(int newWidth, int newHeight);
+	// load a binary (P6) or ascii (P3) ppm file, returns false if it could not be read
+	bool LoadPPM(const std::string& path);
+	// save as a binary 8 bit ppm file
+	bool SavePPM(const std::string& path) const;
+};
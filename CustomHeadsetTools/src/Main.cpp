@@ -0,0 +1,308 @@
+#include "ToolArguments.h"
+#include "ToolProfile.h"
+#include "Image.h"
+#include "DistortionWarper.h"
+#include "DistortionMeshExporter.h"
+#include "FlightRecorderDecoder.h"
+#include "RadialBezierFitter.h"
+#include "RenderTargetSimulator.h"
+#include "../../CustomHeadsetOpenVR/src/Headsets/MeganeX8KDistortion.h"
+#include "../../CustomHeadsetOpenVR/src/Headsets/MeganeX8KPanelModes.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/WorkerPool.h"
+#include "../../CustomHeadsetOpenVR/src/Distortion/DistortionPluginLoader.h"
+#include "../../CustomHeadsetOpenVR/src/Distortion/DistortionMailbox.h"
+#include "../../CustomHeadsetOpenVR/src/Config/ConfigLoader.h"
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+
+static void PrintUsage(){
+	printf(
+		"Usage: CustomHeadsetTools <command> [options]\n"
+		"\n"
+		"warp        warp an eye image onto the panel with a distortion profile\n"
+		"  --input <file.ppm>        eye image as rendered by the application\n"
+		"  --output <file.ppm>       panel image to write\n"
+		"  --profile <name|file>     distortion profile name or json file, default MeganeX8K Default\n"
+		"  --eye <left|right>        eye to warp, default left\n"
+		"\n"
+		"export-mesh export the distortion of both eyes evaluated on a grid\n"
+		"  --output <file>           file to write, .csv and .obj are written as text and anything else as binary\n"
+		"  --profile <name|file>     distortion profile name or json file, default MeganeX8K Default\n"
+		"  --grid <points>           grid points in each direction, default 256\n"
+		"  --no-inverse              do not include the inverse mapping\n"
+		"\n"
+		"fit         fit a RadialBezier profile to measured samples of the lens\n"
+		"  --samples <file.csv>      lines of channel,degree,pixels with channel r, g or b and pixels from the lens center\n"
+		"  --output <profile.json>   profile to write, copy it to the Distortion folder to use it\n"
+		"  --knots <count>           points of the green curve, default 8\n"
+		"  --chromatic-knots <count> points of the red and blue curves, default 4\n"
+		"  --edge <degrees>          degree of the last point, default the largest sample degree\n"
+		"  --iterations <count>      maximum iterations, default 100\n"
+		"\n"
+		"flight-recorder print the events kept by the flight recorder of the driver\n"
+		"  --input <file>            FlightRecorder.bin or FlightRecorder.bin.previous from the config folder\n"
+		"  --seconds <seconds>       only print events this long before the newest one, default all\n"
+		"\n"
+		"render-target run the adaptive render target controller over a frame timing trace and check that it settles\n"
+		"  --input <file>            recorded trace in the format of adaptiveRenderTarget timingFile, default a synthetic application\n"
+		"  --gpu-ms <ms>             gpu time of the synthetic application at a scale of 1, default 10\n"
+		"  --frames <count>          frames of the synthetic application, default 3000\n"
+		"  --refresh <hz>            refresh rate of the panel, default 90\n"
+		"  --scale <scale>           scale to start at, default 1\n"
+		"  --min-scale <scale>       smallest scale, default 0.7\n"
+		"  --max-scale <scale>       largest scale, default 1.2\n"
+		"  --target-load <load>      fraction of the frame time the application should use, default 0.8\n"
+		"  --hysteresis <load>       how far the load has to be from the target before the scale changes, default 0.1\n"
+		"\n"
+		"push-profile send a distortion profile to the running driver through the distortion mailbox\n"
+		"  --profile <name|file>     distortion profile name in the config folder or json file\n"
+		"                            enableDistortionMailbox must be set in the driver settings\n"
+		"\n"
+		"common options\n"
+		"  --panel-mode <mode>       panel mode to take the size of one eye from, default 7104x3840\n"
+		"  --size <pixels>           size of one eye, overrides the panel mode\n"
+		"  --threads <count>         worker threads, default is the number of cores\n"
+	);
+}
+
+// size of one eye from --size or --panel-mode
+// returns 0 after printing the valid values if either is invalid, so a typo does not produce output for the wrong resolution
+static int GetEyeSize(const ToolArguments& arguments){
+	std::string modeName = arguments.GetString("panel-mode", meganeX8KPanelModes[0].name);
+	if(!IsMeganeX8KPanelMode(modeName)){
+		printf("Unknown panel mode %s, the panel modes are:", modeName.c_str());
+		for(const MeganeX8KPanelMode& mode : meganeX8KPanelModes){
+			printf(" %s", mode.name);
+		}
+		printf("\n");
+		return 0;
+	}
+	int size = arguments.GetInt("size", (int)FindMeganeX8KPanelMode(modeName).eyeSize);
+	if(size <= 0){
+		printf("The size must be above 0\n");
+		return 0;
+	}
+	return size;
+}
+
+static int WarpCommand(const ToolArguments& arguments){
+	if(!arguments.Has("input") || !arguments.Has("output")){
+		PrintUsage();
+		return 1;
+	}
+	int size = GetEyeSize(arguments);
+	if(size == 0){
+		return 1;
+	}
+	vr::EVREye eye = arguments.GetString("eye", "left") == "right" ? vr::Eye_Right : vr::Eye_Left;
+
+	DistortionProfileConstructor constructor;
+	if(!LoadToolProfile(constructor, arguments.GetString("profile", "MeganeX8K Default"), size)){
+		return 1;
+	}
+	Image input;
+	if(!input.LoadPPM(arguments.GetString("input"))){
+		return 1;
+	}
+
+	DistortionWarper warper;
+	warper.profile = constructor.profile;
+	warper.subpixelOffset = MeganeX8KSubpixelOffset(size);
+	Image output;
+	auto start = std::chrono::steady_clock::now();
+	warper.Warp(input, output, eye, size);
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Warped %dx%d to %dx%d in %.1fms\n", input.width, input.height, output.width, output.height, milliseconds);
+
+	if(!output.SavePPM(arguments.GetString("output"))){
+		return 1;
+	}
+	return 0;
+}
+
+static int ExportMeshCommand(const ToolArguments& arguments){
+	if(!arguments.Has("output")){
+		PrintUsage();
+		return 1;
+	}
+	int size = GetEyeSize(arguments);
+	if(size == 0){
+		return 1;
+	}
+	DistortionProfileConstructor constructor;
+	if(!LoadToolProfile(constructor, arguments.GetString("profile", "MeganeX8K Default"), size)){
+		return 1;
+	}
+
+	DistortionMeshExporter exporter;
+	exporter.profile = constructor.profile;
+	exporter.subpixelOffset = MeganeX8KSubpixelOffset(size);
+	exporter.gridWidth = exporter.gridHeight = std::max(1, arguments.GetInt("grid", 256));
+	exporter.includeInverse = !arguments.Has("no-inverse");
+
+	std::string output = arguments.GetString("output");
+	std::string extension = output.size() >= 4 ? output.substr(output.size() - 4) : "";
+	auto start = std::chrono::steady_clock::now();
+	bool written = false;
+	if(extension == ".csv"){
+		written = exporter.ExportCSV(output);
+	}else if(extension == ".obj"){
+		written = exporter.ExportOBJ(output);
+	}else{
+		written = exporter.ExportBinary(output);
+	}
+	if(!written){
+		return 1;
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Exported a %dx%d grid for each eye to %s in %.1fms\n", exporter.gridWidth, exporter.gridHeight, output.c_str(), milliseconds);
+	return 0;
+}
+
+static int FitCommand(const ToolArguments& arguments){
+	if(!arguments.Has("samples") || !arguments.Has("output")){
+		PrintUsage();
+		return 1;
+	}
+	std::vector<CalibrationSample> samples;
+	if(!LoadCalibrationSamples(arguments.GetString("samples"), samples)){
+		return 1;
+	}
+	float edgeDegree = 0;
+	for(const CalibrationSample& sample : samples){
+		edgeDegree = std::max(edgeDegree, sample.degree);
+	}
+	edgeDegree = (float)arguments.GetDouble("edge", edgeDegree);
+	if(edgeDegree <= 0){
+		printf("The samples need degrees above 0\n");
+		return 1;
+	}
+
+	RadialBezierFitter fitter;
+	fitter.resolution = GetEyeSize(arguments);
+	if(fitter.resolution == 0){
+		return 1;
+	}
+	fitter.maxIterations = arguments.GetInt("iterations", 100);
+	fitter.SetKnots(arguments.GetInt("knots", 8), arguments.GetInt("chromatic-knots", 4), edgeDegree);
+	RadialBezierFitter::Result result;
+	auto start = std::chrono::steady_clock::now();
+	if(!fitter.Fit(samples, result)){
+		return 1;
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Fit %zu samples in %d iterations in %.1fms\n", samples.size(), result.iterations, milliseconds);
+	const char* channelNames[3] = {"red", "green", "blue"};
+	for(int channel = 0; channel < 3; channel++){
+		if(result.channels[channel].samples > 0){
+			printf("  %-5s %6zu samples, rms error %.3fpx, max error %.3fpx\n", channelNames[channel], result.channels[channel].samples, result.channels[channel].rmsPixels, result.channels[channel].maxPixels);
+		}
+	}
+	char description[128];
+	snprintf(description, sizeof(description), "Fitted to %zu samples with a green rms error of %.3fpx", samples.size(), result.channels[ColorChannelGreen].rmsPixels);
+	if(!fitter.WriteProfile(arguments.GetString("output"), description)){
+		return 1;
+	}
+	return 0;
+}
+
+static int FlightRecorderCommand(const ToolArguments& arguments){
+	if(!arguments.Has("input")){
+		PrintUsage();
+		return 1;
+	}
+	return DecodeFlightRecorder(arguments.GetString("input"), arguments.GetDouble("seconds", 0), stdout) ? 0 : 1;
+}
+
+static int RenderTargetCommand(const ToolArguments& arguments){
+	RenderTargetSimulator simulator;
+	simulator.frameBudgetMs = 1000.0 / std::max(1.0, arguments.GetDouble("refresh", 90));
+	simulator.startScale = arguments.GetDouble("scale", 1.0);
+	simulator.syntheticGpuMs = arguments.GetDouble("gpu-ms", simulator.syntheticGpuMs);
+	simulator.syntheticFrames = arguments.GetInt("frames", simulator.syntheticFrames);
+	// limits the same way MeganeX8KShim applies the config
+	simulator.controller.minScale = arguments.GetDouble("min-scale", simulator.controller.minScale);
+	simulator.controller.maxScale = std::max(simulator.controller.minScale, arguments.GetDouble("max-scale", simulator.controller.maxScale));
+	simulator.controller.targetLoad = arguments.GetDouble("target-load", simulator.controller.targetLoad);
+	simulator.controller.hysteresis = arguments.GetDouble("hysteresis", simulator.controller.hysteresis);
+
+	RenderTargetSimulator::Result result;
+	if(arguments.Has("input")){
+		if(!simulator.RunTrace(arguments.GetString("input"), result, stdout)){
+			return 1;
+		}
+	}else{
+		simulator.RunSynthetic(result, stdout);
+	}
+	printf("%zu frames, %d changes, scale %.2f with a load of %.1f%%\n", result.frames, result.changes, result.scale, result.load * 100.0);
+	if(result.converged){
+		printf("Converged within %.0f%% of the target load\n", simulator.controller.hysteresis * 100.0);
+	}else if(result.clamped){
+		printf("Clamped at the %s scale\n", result.scale <= simulator.controller.minScale + 1e-6 ? "minimum" : "maximum");
+	}else if(!result.settled){
+		printf("The trace ended before the scale settled\n");
+		return 1;
+	}else{
+		printf("Did not converge\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int PushProfileCommand(const ToolArguments& arguments){
+	if(!arguments.Has("profile")){
+		PrintUsage();
+		return 1;
+	}
+	std::string nameOrPath = arguments.GetString("profile");
+	std::filesystem::path path = nameOrPath;
+	DistortionProfileConfig config;
+	if(path.extension() == ".json"){
+		config = driverConfigLoader.ParseDistortionConfigFile(nameOrPath, path.stem().string());
+	}else{
+		config = driverConfigLoader.ParseDistortionConfig(nameOrPath);
+	}
+	if(config.name == "None"){
+		// the reason has already been logged by the config loader
+		return 1;
+	}
+	DistortionMailbox mailbox;
+	if(!mailbox.Open() || !mailbox.Publish(config)){
+		return 1;
+	}
+	printf("Pushed distortion profile %s\n", config.name.c_str());
+	return 0;
+}
+
+int main(int argc, char** argv){
+	ToolArguments arguments;
+	arguments.Parse(argc, argv);
+
+	int threads = arguments.GetInt("threads", (int)std::thread::hardware_concurrency());
+	driverWorkerPool.Start(threads, {});
+	// profiles can use the same distortion plugins as the driver
+	driverDistortionPlugins.LoadPlugins(driverConfigLoader.GetConfigFolder() + "Plugins/");
+
+	int result = 1;
+	if(arguments.command == "warp"){
+		result = WarpCommand(arguments);
+	}else if(arguments.command == "export-mesh"){
+		result = ExportMeshCommand(arguments);
+	}else if(arguments.command == "fit"){
+		result = FitCommand(arguments);
+	}else if(arguments.command == "flight-recorder"){
+		result = FlightRecorderCommand(arguments);
+	}else if(arguments.command == "render-target"){
+		result = RenderTargetCommand(arguments);
+	}else if(arguments.command == "push-profile"){
+		result = PushProfileCommand(arguments);
+	}else{
+		PrintUsage();
+	}
+	driverWorkerPool.Stop();
+	return result;
+}
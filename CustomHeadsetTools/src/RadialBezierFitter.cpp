@@ -0,0 +1,354 @@
+#include "RadialBezierFitter.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/WorkerPool.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/DriverLog.h"
+#include "nlohmann/json.hpp"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+using json = nlohmann::json;
+typedef RadialBezierDistortionProfile::DistortionPoint DistortionPoint;
+
+
+bool LoadCalibrationSamples(const std::string& path, std::vector<CalibrationSample>& samples){
+	std::ifstream file(path);
+	if(!file.is_open()){
+		DriverLog("Could not open %s", path.c_str());
+		return false;
+	}
+	std::string line;
+	while(std::getline(file, line)){
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::istringstream values(line);
+		std::string channel;
+		CalibrationSample sample;
+		if(!(values >> channel >> sample.degree >> sample.radiusPixels)){
+			continue;
+		}
+		if(channel == "r" || channel == "red"){
+			sample.channel = ColorChannelRed;
+		}else if(channel == "g" || channel == "green"){
+			sample.channel = ColorChannelGreen;
+		}else if(channel == "b" || channel == "blue"){
+			sample.channel = ColorChannelBlue;
+		}else{
+			continue;
+		}
+		samples.push_back(sample);
+	}
+	return true;
+}
+
+// solve a symmetric positive definite system in place with a Cholesky decomposition, returns false if it is not positive definite
+static bool SolveCholesky(std::vector<double>& a, std::vector<double>& b, int n){
+	for(int j = 0; j < n; j++){
+		double diagonal = a[j * n + j];
+		for(int k = 0; k < j; k++){
+			diagonal -= a[j * n + k] * a[j * n + k];
+		}
+		if(diagonal <= 0){
+			return false;
+		}
+		a[j * n + j] = std::sqrt(diagonal);
+		for(int i = j + 1; i < n; i++){
+			double value = a[i * n + j];
+			for(int k = 0; k < j; k++){
+				value -= a[i * n + k] * a[j * n + k];
+			}
+			a[i * n + j] = value / a[j * n + j];
+		}
+	}
+	// forward then back substitution with the lower triangle
+	for(int i = 0; i < n; i++){
+		for(int k = 0; k < i; k++){
+			b[i] -= a[i * n + k] * b[k];
+		}
+		b[i] /= a[i * n + i];
+	}
+	for(int i = n - 1; i >= 0; i--){
+		for(int k = i + 1; k < n; k++){
+			b[i] -= a[k * n + i] * b[k];
+		}
+		b[i] /= a[i * n + i];
+	}
+	return true;
+}
+
+void RadialBezierFitter::SetKnots(int knots, int chromaticKnots, float edgeDegree){
+	knots = std::max(knots, 2);
+	chromaticKnots = std::max(chromaticKnots, 2);
+	knotDegrees.clear();
+	distortions.clear();
+	for(int i = 0; i < knots; i++){
+		float t = (float)i / (knots - 1);
+		knotDegrees.push_back(edgeDegree * t);
+		distortions.push_back({edgeDegree * t, 100.0f * t});
+	}
+	chromaticKnotDegrees.clear();
+	distortionsRed.clear();
+	distortionsBlue.clear();
+	for(int i = 0; i < chromaticKnots; i++){
+		float degree = edgeDegree * i / (chromaticKnots - 1);
+		chromaticKnotDegrees.push_back(degree);
+		distortionsRed.push_back({degree, 0});
+		distortionsBlue.push_back({degree, 0});
+	}
+}
+
+double RadialBezierFitter::PixelsPerPercent(){
+	return resolution / 2.0 / 100.0;
+}
+
+int RadialBezierFitter::ParameterCount(){
+	return (int)(distortions.size() - 1 + distortionsRed.size() + distortionsBlue.size());
+}
+
+std::vector<double> RadialBezierFitter::GetParameters(){
+	std::vector<double> parameters;
+	for(size_t i = 1; i < distortions.size(); i++){
+		parameters.push_back(distortions[i].position);
+	}
+	for(const DistortionPoint& point : distortionsRed){
+		parameters.push_back(point.position);
+	}
+	for(const DistortionPoint& point : distortionsBlue){
+		parameters.push_back(point.position);
+	}
+	return parameters;
+}
+
+void RadialBezierFitter::SetParameters(const std::vector<double>& parameters){
+	size_t index = 0;
+	for(size_t i = 1; i < distortions.size(); i++){
+		distortions[i].position = (float)parameters[index++];
+	}
+	for(DistortionPoint& point : distortionsRed){
+		point.position = (float)parameters[index++];
+	}
+	for(DistortionPoint& point : distortionsBlue){
+		point.position = (float)parameters[index++];
+	}
+}
+
+RadialBezierFitter::ChannelCurves RadialBezierFitter::BuildCurves(){
+	ChannelCurves curves;
+	RadialBezierDistortionProfile::BuildCurves(distortions, distortionsRed, distortionsBlue, curves.channels[ColorChannelRed], curves.channels[ColorChannelGreen], curves.channels[ColorChannelBlue]);
+	return curves;
+}
+
+// same points with every position set to 0 except index which is 1
+static std::vector<DistortionPoint> UnitPoints(const std::vector<DistortionPoint>& points, size_t index){
+	std::vector<DistortionPoint> unit = points;
+	for(size_t i = 0; i < unit.size(); i++){
+		unit[i].position = i == index ? 1.0f : 0.0f;
+	}
+	return unit;
+}
+
+// position b minus a, the curves have the same degrees
+static std::vector<DistortionPoint> SubtractCurves(const std::vector<DistortionPoint>& b, const std::vector<DistortionPoint>& a){
+	std::vector<DistortionPoint> difference = b;
+	for(size_t i = 0; i < difference.size(); i++){
+		difference[i].position -= a[i].position;
+	}
+	return difference;
+}
+
+std::vector<RadialBezierFitter::ChannelCurves> RadialBezierFitter::BuildJacobianCurves(){
+	std::vector<ChannelCurves> jacobianCurves;
+	// every channel is linear in the green positions
+	for(size_t i = 1; i < distortions.size(); i++){
+		ChannelCurves curves;
+		RadialBezierDistortionProfile::BuildCurves(UnitPoints(distortions, i), distortionsRed, distortionsBlue, curves.channels[ColorChannelRed], curves.channels[ColorChannelGreen], curves.channels[ColorChannelBlue]);
+		jacobianCurves.push_back(curves);
+	}
+	// red and blue are affine in their percentages, the green curve does not depend on them and is left empty
+	std::vector<DistortionPoint> zeroRed = UnitPoints(distortionsRed, distortionsRed.size());
+	std::vector<DistortionPoint> zeroBlue = UnitPoints(distortionsBlue, distortionsBlue.size());
+	ChannelCurves offset;
+	RadialBezierDistortionProfile::BuildCurves(distortions, zeroRed, zeroBlue, offset.channels[ColorChannelRed], offset.channels[ColorChannelGreen], offset.channels[ColorChannelBlue]);
+	for(size_t i = 0; i < distortionsRed.size(); i++){
+		ChannelCurves unit;
+		RadialBezierDistortionProfile::BuildCurves(distortions, UnitPoints(distortionsRed, i), zeroBlue, unit.channels[ColorChannelRed], unit.channels[ColorChannelGreen], unit.channels[ColorChannelBlue]);
+		ChannelCurves curves;
+		curves.channels[ColorChannelRed] = SubtractCurves(unit.channels[ColorChannelRed], offset.channels[ColorChannelRed]);
+		jacobianCurves.push_back(curves);
+	}
+	for(size_t i = 0; i < distortionsBlue.size(); i++){
+		ChannelCurves unit;
+		RadialBezierDistortionProfile::BuildCurves(distortions, zeroRed, UnitPoints(distortionsBlue, i), unit.channels[ColorChannelRed], unit.channels[ColorChannelGreen], unit.channels[ColorChannelBlue]);
+		ChannelCurves curves;
+		curves.channels[ColorChannelBlue] = SubtractCurves(unit.channels[ColorChannelBlue], offset.channels[ColorChannelBlue]);
+		jacobianCurves.push_back(curves);
+	}
+	return jacobianCurves;
+}
+
+double RadialBezierFitter::Accumulate(const std::vector<CalibrationSample>& samples, const ChannelCurves& curves, const std::vector<ChannelCurves>* jacobianCurves, std::vector<double>& jtj, std::vector<double>& jtr){
+	int parameterCount = jacobianCurves != nullptr ? (int)jacobianCurves->size() : 0;
+	double pixelsPerPercent = PixelsPerPercent();
+	size_t chunkSize = std::max((size_t)1, chunkSamples);
+	size_t chunkCount = (samples.size() + chunkSize - 1) / chunkSize;
+	// each chunk sums into its own normal equations which are added up afterwards
+	std::vector<std::vector<double>> chunkJtj(chunkCount, std::vector<double>((size_t)parameterCount * parameterCount, 0.0));
+	std::vector<std::vector<double>> chunkJtr(chunkCount, std::vector<double>(parameterCount, 0.0));
+	std::vector<double> chunkCost(chunkCount, 0.0);
+	std::vector<WorkerJobHandle> jobs;
+	for(size_t chunk = 0; chunk < chunkCount; chunk++){
+		jobs.push_back(driverWorkerPool.Submit("RadialBezierFitter::Accumulate", WorkerPriorityNormal, [&, chunk](WorkerJob& job){
+			std::vector<double> row(parameterCount);
+			std::vector<double>& localJtj = chunkJtj[chunk];
+			std::vector<double>& localJtr = chunkJtr[chunk];
+			size_t end = std::min(samples.size(), (chunk + 1) * chunkSize);
+			for(size_t s = chunk * chunkSize; s < end; s++){
+				const CalibrationSample& sample = samples[s];
+				double residual = RadialBezierDistortionProfile::SampleCurve(curves.channels[sample.channel], sample.degree) * pixelsPerPercent - sample.radiusPixels;
+				chunkCost[chunk] += residual * residual;
+				if(parameterCount == 0){
+					continue;
+				}
+				for(int p = 0; p < parameterCount; p++){
+					const Curve& derivative = (*jacobianCurves)[p].channels[sample.channel];
+					row[p] = derivative.empty() ? 0.0 : RadialBezierDistortionProfile::SampleCurve(derivative, sample.degree) * pixelsPerPercent;
+				}
+				// only the lower triangle, it is mirrored once everything is summed
+				for(int i = 0; i < parameterCount; i++){
+					if(row[i] == 0){
+						continue;
+					}
+					for(int j = 0; j <= i; j++){
+						localJtj[i * parameterCount + j] += row[i] * row[j];
+					}
+					localJtr[i] += row[i] * residual;
+				}
+			}
+		}));
+	}
+	for(WorkerJobHandle& job : jobs){
+		job->Wait();
+	}
+	jtj.assign((size_t)parameterCount * parameterCount, 0.0);
+	jtr.assign(parameterCount, 0.0);
+	double cost = 0;
+	for(size_t chunk = 0; chunk < chunkCount; chunk++){
+		cost += chunkCost[chunk];
+		for(size_t i = 0; i < jtj.size(); i++){
+			jtj[i] += chunkJtj[chunk][i];
+		}
+		for(int i = 0; i < parameterCount; i++){
+			jtr[i] += chunkJtr[chunk][i];
+		}
+	}
+	for(int i = 0; i < parameterCount; i++){
+		for(int j = 0; j < i; j++){
+			jtj[j * parameterCount + i] = jtj[i * parameterCount + j];
+		}
+	}
+	return cost;
+}
+
+bool RadialBezierFitter::Fit(const std::vector<CalibrationSample>& samples, Result& result){
+	int parameterCount = ParameterCount();
+	if(samples.size() < (size_t)parameterCount){
+		DriverLog("Need at least %d samples to fit %d parameters, got %zu", parameterCount, parameterCount, samples.size());
+		return false;
+	}
+	std::vector<double> parameters = GetParameters();
+	std::vector<double> jtj, jtr, unused;
+	std::vector<ChannelCurves> jacobianCurves = BuildJacobianCurves();
+	double cost = Accumulate(samples, BuildCurves(), &jacobianCurves, jtj, jtr);
+	double damping = 1e-3;
+	int iteration = 0;
+	for(; iteration < maxIterations; iteration++){
+		bool improved = false;
+		double newCost = cost;
+		while(damping < 1e12){
+			// damp towards gradient descent scaled by the curvature of each parameter
+			// parameters without samples, such as red without red samples, have no curvature and are kept as they are
+			std::vector<double> a = jtj;
+			std::vector<double> step(parameterCount);
+			for(int i = 0; i < parameterCount; i++){
+				double diagonal = jtj[i * parameterCount + i];
+				a[i * parameterCount + i] = diagonal > 0 ? diagonal * (1.0 + damping) : 1.0;
+				step[i] = diagonal > 0 ? -jtr[i] : 0.0;
+			}
+			if(SolveCholesky(a, step, parameterCount)){
+				std::vector<double> candidate = parameters;
+				for(int i = 0; i < parameterCount; i++){
+					candidate[i] += step[i];
+				}
+				SetParameters(candidate);
+				newCost = Accumulate(samples, BuildCurves(), nullptr, unused, unused);
+				if(newCost < cost){
+					parameters = candidate;
+					improved = true;
+					damping = std::max(damping / 10.0, 1e-12);
+					break;
+				}
+			}
+			damping *= 10.0;
+		}
+		SetParameters(parameters);
+		if(!improved){
+			break;
+		}
+		double decrease = cost - newCost;
+		jacobianCurves = BuildJacobianCurves();
+		cost = Accumulate(samples, BuildCurves(), &jacobianCurves, jtj, jtr);
+		// stop once the error is not changing by a meaningful amount
+		if(decrease <= cost * 1e-9){
+			iteration++;
+			break;
+		}
+	}
+	result.iterations = iteration;
+	ComputeErrors(samples, result);
+	return true;
+}
+
+void RadialBezierFitter::ComputeErrors(const std::vector<CalibrationSample>& samples, Result& result){
+	ChannelCurves curves = BuildCurves();
+	double pixelsPerPercent = PixelsPerPercent();
+	for(ChannelError& channel : result.channels){
+		channel = {};
+	}
+	for(const CalibrationSample& sample : samples){
+		double residual = RadialBezierDistortionProfile::SampleCurve(curves.channels[sample.channel], sample.degree) * pixelsPerPercent - sample.radiusPixels;
+		ChannelError& channel = result.channels[sample.channel];
+		channel.samples++;
+		channel.rmsPixels += residual * residual;
+		channel.maxPixels = std::max(channel.maxPixels, std::abs(residual));
+	}
+	for(ChannelError& channel : result.channels){
+		if(channel.samples > 0){
+			channel.rmsPixels = std::sqrt(channel.rmsPixels / channel.samples);
+		}
+	}
+}
+
+// flatten points to the degree, position pairs used by profile files
+static std::vector<double> FlattenPoints(const std::vector<DistortionPoint>& points){
+	std::vector<double> values;
+	for(const DistortionPoint& point : points){
+		values.push_back(point.degree);
+		values.push_back(point.position);
+	}
+	return values;
+}
+
+bool RadialBezierFitter::WriteProfile(const std::string& path, const std::string& description){
+	std::ofstream file(path);
+	if(!file.is_open()){
+		DriverLog("Could not write to %s", path.c_str());
+		return false;
+	}
+	json data = json::object();
+	data["description"] = description;
+	data["type"] = "RadialBezier";
+	data["distortions"] = FlattenPoints(distortions);
+	data["distortionsRed"] = FlattenPoints(distortionsRed);
+	data["distortionsBlue"] = FlattenPoints(distortionsBlue);
+	file << data.dump(4) << std::endl;
+	return file.good();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "../../CustomHeadsetOpenVR/src/Distortion/RadialBezierDistortionProfile.h"
+#include <string>
+#include <vector>
+
+
+// a measured point of the lens, the panel radius a channel lands at for a field angle
+struct CalibrationSample{
+	ColorChannel channel;
+	// angle from the optical axis in degrees
+	float degree;
+	// distance from the lens center on the panel in pixels
+	float radiusPixels;
+};
+
+// load samples from a csv file with a line of channel,degree,pixels for each sample
+// channel is r, g or b, lines that don't parse such as a header are skipped
+bool LoadCalibrationSamples(const std::string& path, std::vector<CalibrationSample>& samples);
+
+
+// Fits the points of a RadialBezier profile to calibration samples with Levenberg-Marquardt.
+// The knot degrees are fixed and the positions of the green knots and the red and blue percentages are optimised together.
+// The curve model of RadialBezierDistortionProfile is linear in the green positions and, for fixed green positions,
+// in the red and blue percentages, so each column of the Jacobian is the curve built from a unit vector of that parameter.
+// Samples are split into chunks that accumulate the normal equations on the worker pool.
+class RadialBezierFitter{
+public:
+	// degrees of the green knots, the first must be 0 where the position stays 0
+	std::vector<float> knotDegrees;
+	// degrees of the red and blue knots
+	std::vector<float> chromaticKnotDegrees;
+	// width of one eye in pixels, a position of 100 is half of this
+	int resolution = 3552;
+	int maxIterations = 100;
+	// samples in each job
+	size_t chunkSamples = 1024;
+
+	// fitted points, these start as the initial guess when Fit is called
+	std::vector<RadialBezierDistortionProfile::DistortionPoint> distortions;
+	std::vector<RadialBezierDistortionProfile::DistortionPoint> distortionsRed;
+	std::vector<RadialBezierDistortionProfile::DistortionPoint> distortionsBlue;
+
+	struct ChannelError{
+		size_t samples = 0;
+		double rmsPixels = 0;
+		double maxPixels = 0;
+	};
+	struct Result{
+		int iterations = 0;
+		// by ColorChannel
+		ChannelError channels[3];
+	};
+
+	// set evenly spaced knots up to edgeDegree with a straight line as the initial guess
+	void SetKnots(int knots, int chromaticKnots, float edgeDegree);
+	// fit the points to the samples, returns false if there are too few samples to fit
+	bool Fit(const std::vector<CalibrationSample>& samples, Result& result);
+	// error of the current points for each channel
+	void ComputeErrors(const std::vector<CalibrationSample>& samples, Result& result);
+	// write the points as a profile json that the driver can load from the Distortion folder
+	bool WriteProfile(const std::string& path, const std::string& description);
+private:
+	typedef std::vector<RadialBezierDistortionProfile::DistortionPoint> Curve;
+	// curves of each channel built from the current points, by ColorChannel
+	struct ChannelCurves{
+		Curve channels[3];
+	};
+	int ParameterCount();
+	std::vector<double> GetParameters();
+	void SetParameters(const std::vector<double>& parameters);
+	ChannelCurves BuildCurves();
+	// curves of the derivative of each channel by each parameter
+	std::vector<ChannelCurves> BuildJacobianCurves();
+	// sum of squared residuals in pixels, and the normal equations if jacobianCurves is not null
+	double Accumulate(const std::vector<CalibrationSample>& samples, const ChannelCurves& curves, const std::vector<ChannelCurves>* jacobianCurves, std::vector<double>& jtj, std::vector<double>& jtr);
+	// percent on the display to pixels from the lens center
+	double PixelsPerPercent();
+};
@@ -0,0 +1,68 @@
+#include "RenderTargetSimulator.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/FrameTimingSource.h"
+#include <random>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+
+void RenderTargetSimulator::Start(Result& result){
+	result = {};
+	controller.Reset(startScale);
+	framesSinceChange = 0;
+}
+
+void RenderTargetSimulator::AddSample(const FrameTimingSample& sample, Result& result, FILE* output){
+	result.frames++;
+	framesSinceChange++;
+	if(controller.AddSample(sample, frameBudgetMs)){
+		result.changes++;
+		framesSinceChange = 0;
+		fprintf(output, "frame %6zu  load %5.1f%%  scale %.2f\n", result.frames, controller.GetLastLoad() * 100.0, controller.GetScale());
+	}
+}
+
+void RenderTargetSimulator::Finish(Result& result){
+	result.scale = controller.GetScale();
+	result.load = controller.GetLastLoad();
+	// the window after a change is skipped, so the load is only from the new scale once the window after that was evaluated
+	size_t windowFrames = std::max((size_t)1, controller.windowFrames);
+	result.settled = framesSinceChange >= (result.changes == 0 ? windowFrames : windowFrames * 2);
+	if(!result.settled){
+		return;
+	}
+	result.converged = std::abs(result.load - controller.targetLoad) <= controller.hysteresis;
+	bool atMin = result.scale <= controller.minScale + 1e-6;
+	bool atMax = result.scale >= controller.maxScale - 1e-6;
+	result.clamped = (atMin && result.load > controller.targetLoad + controller.hysteresis) || (atMax && result.load < controller.targetLoad - controller.hysteresis);
+}
+
+void RenderTargetSimulator::RunSynthetic(Result& result, FILE* output){
+	Start(result);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> jitter(-syntheticJitter, syntheticJitter);
+	for(int i = 0; i < syntheticFrames; i++){
+		double scale = controller.GetScale();
+		FrameTimingSample sample;
+		sample.frameIndex = (uint32_t)i + 1;
+		sample.applicationGpuMs = syntheticGpuMs * scale * scale * (1.0 + jitter(random));
+		sample.missed = sample.applicationGpuMs > frameBudgetMs;
+		AddSample(sample, result, output);
+	}
+	Finish(result);
+}
+
+bool RenderTargetSimulator::RunTrace(const std::string& path, Result& result, FILE* output){
+	Start(result);
+	FileFrameTimingSource source(path);
+	std::vector<FrameTimingSample> samples;
+	if(source.Poll(samples) == 0){
+		fprintf(output, "No frame timings in %s\n", path.c_str());
+		return false;
+	}
+	for(const FrameTimingSample& sample : samples){
+		AddSample(sample, result, output);
+	}
+	Finish(result);
+	return true;
+}
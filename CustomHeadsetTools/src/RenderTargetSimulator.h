@@ -0,0 +1,47 @@
+#pragma once
+#include "../../CustomHeadsetOpenVR/src/Driver/RenderTargetController.h"
+#include <string>
+#include <cstdio>
+
+
+// Runs the RenderTargetController of the driver over a frame timing trace to check that its settings settle.
+// A synthetic application has a gpu time proportional to the pixel count of the scale, so the scale it is given feeds back into the trace.
+// A recorded trace in the format of FileFrameTimingSource does not follow the scale, so it only shows what the controller would pick.
+class RenderTargetSimulator{
+public:
+	RenderTargetController controller;
+	// time between vsyncs
+	double frameBudgetMs = 1000.0 / 90.0;
+	// scale the controller starts at
+	double startScale = 1.0;
+	// gpu time of the synthetic application at a scale of 1
+	double syntheticGpuMs = 10.0;
+	// random variation of the synthetic gpu time as a fraction of it, the sequence is the same on every run
+	double syntheticJitter = 0.1;
+	// frames of the synthetic application
+	int syntheticFrames = 3000;
+
+	struct Result{
+		size_t frames = 0;
+		int changes = 0;
+		double scale = 0;
+		// load of the last window that was evaluated
+		double load = 0;
+		// a full window was evaluated after the last change
+		bool settled = false;
+		// the load is within the hysteresis band of the target load
+		bool converged = false;
+		// the scale is at a limit and the load asks to go past it
+		bool clamped = false;
+	};
+
+	// run the synthetic application, every scale change is printed to output
+	void RunSynthetic(Result& result, FILE* output);
+	// run a recorded trace, returns false if the file could not be read
+	bool RunTrace(const std::string& path, Result& result, FILE* output);
+private:
+	size_t framesSinceChange = 0;
+	void Start(Result& result);
+	void AddSample(const FrameTimingSample& sample, Result& result, FILE* output);
+	void Finish(Result& result);
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <map>
+#include <cstdlib>
+
+
+// command line arguments in the form of: command --key value --flag
+class ToolArguments{
+public:
+	std::string command;
+	std::map<std::string, std::string> values;
+
+	void Parse(int argc, char** argv){
+		if(argc > 1){
+			command = argv[1];
+		}
+		for(int i = 2; i < argc; i++){
+			std::string argument = argv[i];
+			if(argument.rfind("--", 0) != 0){
+				continue;
+			}
+			std::string key = argument.substr(2);
+			// a key without a value is a flag
+			if(i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0){
+				values[key] = argv[i + 1];
+				i++;
+			}else{
+				values[key] = "true";
+			}
+		}
+	}
+
+	bool Has(const std::string& key) const{
+		return values.find(key) != values.end();
+	}
+
+	std::string GetString(const std::string& key, const std::string& fallback = "") const{
+		auto value = values.find(key);
+		return value == values.end() ? fallback : value->second;
+	}
+
+	int GetInt(const std::string& key, int fallback) const{
+		auto value = values.find(key);
+		return value == values.end() ? fallback : atoi(value->second.c_str());
+	}
+
+	double GetDouble(const std::string& key, double fallback) const{
+		auto value = values.find(key);
+		return value == values.end() ? fallback : atof(value->second.c_str());
+	}
+};
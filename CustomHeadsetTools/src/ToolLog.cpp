@@ -0,0 +1,25 @@
+#include "../../CustomHeadsetOpenVR/src/Driver/DriverLog.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// the tools share the driver code but there is no vrserver to log to, so logs go to stderr instead
+
+
+void DriverLog(const char *pMsgFormat, ...){
+	va_list args;
+	va_start(args, pMsgFormat);
+	vfprintf(stderr, pMsgFormat, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+}
+
+void DebugDriverLog(const char *pMsgFormat, ...){
+#ifdef _DEBUG
+	va_list args;
+	va_start(args, pMsgFormat);
+	vfprintf(stderr, pMsgFormat, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+#endif
+}
@@ -0,0 +1,28 @@
+#include "ToolProfile.h"
+#include "../../CustomHeadsetOpenVR/src/Driver/DriverLog.h"
+#include <filesystem>
+
+
+bool LoadToolProfile(DistortionProfileConstructor& constructor, const std::string& nameOrPath, int resolution){
+	// match the settings that MeganeX8KShim gives the constructor on activation
+	constructor.distortionSettings.resolution = (float)resolution;
+	constructor.distortionSettings.noneDistortionFovHorizontal = 95;
+	constructor.distortionSettings.noneDistortionFovVertical = 95;
+
+	std::filesystem::path path = nameOrPath;
+	if(path.extension() == ".json"){
+		DistortionProfileConfig config = driverConfigLoader.ParseDistortionConfigFile(nameOrPath, path.stem().string());
+		if(config.name == "None"){
+			// the reason has already been logged by the config loader
+			return false;
+		}
+		constructor.LoadDistortionProfile(config);
+		return true;
+	}
+	constructor.LoadDistortionProfile(nameOrPath);
+	if(constructor.profile == &constructor.distortionSettings && nameOrPath != "None"){
+		DriverLog("Could not load distortion profile %s", nameOrPath.c_str());
+		return false;
+	}
+	return true;
+}
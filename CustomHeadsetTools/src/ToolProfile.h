@@ -0,0 +1,10 @@
+#pragma once
+#include "../../CustomHeadsetOpenVR/src/Distortion/DistortionProfileConstructor.h"
+#include <string>
+
+
+// load a distortion profile for a tool
+// nameOrPath is either a path to a json file or the name of a built in profile or a profile in the config folder
+// resolution is the panel resolution of one eye
+// returns false if the profile could not be loaded, the constructor then holds the None profile
+bool LoadToolProfile(DistortionProfileConstructor& constructor, const std::string& nameOrPath, int resolution);